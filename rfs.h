@@ -20,12 +20,58 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include <limits.h>
+#include <stdint.h>
 
 // Network and system configuration constants
 #define PORT 2024                // Port number for socket communication
 #define SERVER_ROOT "./server_root/"  // Base directory for server-side file storage
+#define SERVER_META_ROOT "./server_meta/"  // Base directory for stored file digests
+#define SERVER_STAGING_ROOT "./server_staging/"  // Uploads in progress, outside SERVER_ROOT
+#define DEFAULT_LOG_PATH "rfserver.log"     // Server log file unless -l is given
 #define BUFFER_SIZE 8192         // Standard buffer size for file transfers
 
+/*
+ * Wire protocol
+ * A connection carries any number of requests back to back; the server
+ * keeps serving it until the client closes. Each request starts with a
+ * Command and is followed by:
+ *   WRITE: client sends a payload, server replies int status
+ *   GET:   server sends a payload (filesize -1 and nothing else if unavailable)
+ *   RM:    server replies int status
+ *
+ * A payload is a long filesize, then the data in BUFFER_SIZE chunks (the
+ * last one may be shorter) each followed by the uint32_t CRC32C of that
+ * chunk, then the uint32_t CRC32C of the whole file.
+ */
+#define RFS_STATUS_CORRUPT -2    // WRITE status: payload failed CRC32C verification
+
+/**
+ * Header of a stored file digest (SERVER_META_ROOT/<remote-path>.crc)
+ * Followed by one uint32_t CRC32C per chunk. The inode, size and mtime
+ * (to the nanosecond) identify the exact file version the digest was
+ * computed for.
+ */
+typedef struct {
+    uint32_t magic;               // DIGEST_MAGIC
+    uint32_t chunk_size;          // Chunk size the CRCs were computed with
+    uint64_t inode;               // Inode of the data file
+    int64_t size;                 // Size of the data file
+    int64_t mtime_ns;             // Modification time of the data file, in nanoseconds
+    uint32_t file_crc;            // CRC32C of the whole file
+    uint32_t chunks;              // Number of chunk CRCs that follow
+} DigestHeader;
+
+#define DIGEST_MAGIC 0x44534652   // "RFSD"; digests from older layouts are ignored
+
+/**
+ * Running whole-file CRC32C built from per-chunk CRCs
+ * Combining chunk CRCs avoids hashing the data a second time
+ */
+typedef struct {
+    uint32_t file_crc;            // CRC32C of the chunks added so far
+    uint32_t chunk_op;            // Combine operator for a full BUFFER_SIZE chunk
+} PayloadDigest;
+
 /**
  * Enumeration of supported command types
  * Defines the operations that can be performed in the remote file system
@@ -55,34 +101,56 @@ typedef struct {
 typedef struct {
     Command cmd;                  // Command details
     int client_sock;              // Client socket descriptor
+    struct in_addr client_addr;   // Client IPv4 address
+    struct SchedFlow *flow;       // I/O scheduler state for this connection
+    uint32_t conn_id;             // Connection ID in logs and traces
+    uint64_t trace_id;            // ID of the request being served
     char full_path[PATH_MAX];     // Fully resolved path on server
+    char meta_path[PATH_MAX];     // Path of the file's stored digest
 } ServerThreadData;
 
-// Function prototypes for client-side operations
+// Socket helpers shared by client and server (rfs_net.c)
 /**
- * Parse command-line arguments into a Command structure
- * @param argc Number of command-line arguments
- * @param argv Array of command-line argument strings
- * @param cmd Pointer to Command structure to be populated
- * @return 0 on success, -1 on invalid input
+ * Send an entire buffer, retrying on short writes
+ * @param socket Connected socket descriptor
+ * @param buf Data to send
+ * @param len Number of bytes to send
+ * @return 0 on success, -1 on error
  */
-int parse_command(int argc, char *argv[], Command *cmd);
+int rfs_send_all(int socket, const void *buf, size_t len);
 
 /**
- * Send file contents over a socket
+ * Receive exactly len bytes, retrying on short reads
  * @param socket Connected socket descriptor
- * @param filepath Path to the file to be sent
- * @return 0 on success, -1 on error
+ * @param buf Destination buffer
+ * @param len Number of bytes to receive
+ * @return len on success, fewer if the peer closed, -1 on error
  */
-int send_file(int socket, const char *filepath);
+ssize_t rfs_recv_all(int socket, void *buf, size_t len);
 
 /**
- * Receive file contents from a socket
- * @param socket Connected socket descriptor
- * @param filepath Path where file will be saved
- * @return 0 on success, -1 on error
+ * Start a whole-file digest
+ * @param digest Digest to initialize
+ */
+void rfs_digest_init(PayloadDigest *digest);
+
+/**
+ * Append a chunk to a whole-file digest
+ * @param digest Digest to extend
+ * @param chunk_crc CRC32C of the chunk
+ * @param len Chunk length in bytes
+ */
+void rfs_digest_add(PayloadDigest *digest, uint32_t chunk_crc, size_t len);
+
+// Function prototypes for client-side operations
+/**
+ * Parse command-line arguments into a Command structure
+ * @param argc Number of command-line arguments
+ * @param argv Array of command-line argument strings
+ * @param cmd Pointer to Command structure to be populated
+ * @return 0 on success, -1 on invalid input
  */
-int receive_file(int socket, const char *filepath);
+int parse_command(int argc, char *argv[], Command *cmd);
 
 /**
  * Create directory structure for a given file path
@@ -0,0 +1,205 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_crc32c.c -- CRC32C (Castagnoli) checksums
+ *
+ * The crc32 instruction has a latency of three cycles but can start one
+ * per cycle, so the SSE4.2 path runs three independent lanes over
+ * adjacent blocks and stitches them together with a table-driven shift.
+ * GF(2) polynomial arithmetic for combining CRCs follows zlib's
+ * crc32_combine.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rfs_crc32c.h"
+
+/* One-time table setup */
+#include <pthread.h>
+
+// Build with -DRFS_CRC32C_NO_HW to force the table implementation
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(RFS_CRC32C_NO_HW)
+#include <nmmintrin.h>
+#define CRC32C_HAVE_SSE42 1
+#endif
+
+#define CRC32C_POLY 0x82f63b78  // Castagnoli polynomial, bit-reflected
+#define CRC32C_LANE 1024        // Bytes per lane in the interleaved path
+
+static uint32_t crc32c_table[8][256];      // Slicing-by-8 tables
+static uint32_t crc32c_x2n[32];            // x^(2^n) mod P
+static uint32_t crc32c_lane_shift[4][256]; // Multiply by x^(8 * CRC32C_LANE) mod P
+
+static uint32_t (*crc32c_update)(uint32_t crc, const unsigned char *p, size_t len);
+static const char *crc32c_name;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+/**
+ * multmodp - Multiply two polynomials modulo P (bit-reflected)
+ */
+static uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+/**
+ * x2nmodp - Compute x^(n * 2^k) mod P
+ */
+static uint32_t x2nmodp(size_t n, unsigned k) {
+    uint32_t p = (uint32_t)1 << 31;  // x^0
+    while (n) {
+        if (n & 1) p = multmodp(crc32c_x2n[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+/**
+ * crc32c_sw - Slicing-by-8 update of a raw (non-inverted) CRC register
+ */
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len) {
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                             (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        uint32_t hi = (uint32_t)p[4] | (uint32_t)p[5] << 8 |
+                      (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+        crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+              crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff] ^
+              crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+/**
+ * shift_lane - Advance a raw CRC register past CRC32C_LANE zero bytes
+ */
+static inline uint32_t shift_lane(uint32_t crc) {
+    return crc32c_lane_shift[0][crc & 0xff] ^ crc32c_lane_shift[1][(crc >> 8) & 0xff] ^
+           crc32c_lane_shift[2][(crc >> 16) & 0xff] ^ crc32c_lane_shift[3][crc >> 24];
+}
+
+/**
+ * crc32c_sse42 - Hardware update of a raw CRC register
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len) {
+    uint64_t c0 = crc;
+
+    // Three lanes over adjacent CRC32C_LANE blocks hide the instruction latency
+    while (len >= 3 * CRC32C_LANE) {
+        uint64_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < CRC32C_LANE; i += 8) {
+            uint64_t v0, v1, v2;
+            memcpy(&v0, p + i, 8);
+            memcpy(&v1, p + CRC32C_LANE + i, 8);
+            memcpy(&v2, p + 2 * CRC32C_LANE + i, 8);
+            c0 = _mm_crc32_u64(c0, v0);
+            c1 = _mm_crc32_u64(c1, v1);
+            c2 = _mm_crc32_u64(c2, v2);
+        }
+        c0 = shift_lane(shift_lane((uint32_t)c0) ^ (uint32_t)c1) ^ (uint32_t)c2;
+        p += 3 * CRC32C_LANE;
+        len -= 3 * CRC32C_LANE;
+    }
+
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c0 = _mm_crc32_u64(c0, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        c0 = _mm_crc32_u8((uint32_t)c0, *p++);
+    }
+    return (uint32_t)c0;
+}
+#endif
+
+/**
+ * crc32c_init - Build tables and pick the fastest implementation
+ */
+static void crc32c_init(void) {
+    // Slicing-by-8 tables
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        crc32c_table[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = crc32c_table[0][n];
+        for (int k = 1; k < 8; k++) {
+            c = crc32c_table[0][c & 0xff] ^ (c >> 8);
+            crc32c_table[k][n] = c;
+        }
+    }
+
+    // Powers of x for combining
+    uint32_t p = (uint32_t)1 << 30;  // x^1
+    crc32c_x2n[0] = p;
+    for (int n = 1; n < 32; n++) {
+        crc32c_x2n[n] = p = multmodp(p, p);
+    }
+
+    // Shift-by-one-lane tables, one per byte of the CRC register
+    uint32_t lane_op = x2nmodp(CRC32C_LANE, 3);
+    for (int i = 0; i < 4; i++) {
+        for (uint32_t b = 0; b < 256; b++) {
+            crc32c_lane_shift[i][b] = multmodp(lane_op, b << (8 * i));
+        }
+    }
+
+    crc32c_update = crc32c_sw;
+    crc32c_name = "slicing-by-8";
+#ifdef CRC32C_HAVE_SSE42
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_update = crc32c_sse42;
+        crc32c_name = "sse4.2";
+    }
+#endif
+}
+
+uint32_t rfs_crc32c(uint32_t crc, const void *buf, size_t len) {
+    pthread_once(&crc32c_once, crc32c_init);
+    return ~crc32c_update(~crc, buf, len);
+}
+
+uint32_t rfs_crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2) {
+    pthread_once(&crc32c_once, crc32c_init);
+    return multmodp(x2nmodp(len2, 3), crc1) ^ crc2;
+}
+
+uint32_t rfs_crc32c_combine_gen(size_t len2) {
+    pthread_once(&crc32c_once, crc32c_init);
+    return x2nmodp(len2, 3);
+}
+
+uint32_t rfs_crc32c_combine_op(uint32_t crc1, uint32_t crc2, uint32_t op) {
+    return multmodp(op, crc1) ^ crc2;
+}
+
+const char *rfs_crc32c_impl(void) {
+    pthread_once(&crc32c_once, crc32c_init);
+    return crc32c_name;
+}
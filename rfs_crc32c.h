@@ -0,0 +1,61 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_crc32c.h - CRC32C (Castagnoli) checksums for transfer integrity
+ *
+ * Uses the SSE4.2 crc32 instruction when the CPU has it and a
+ * slicing-by-8 table implementation otherwise. The implementation is
+ * picked once at first use.
+ */
+
+#ifndef RFS_CRC32C_H
+#define RFS_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Extend a CRC32C over more data
+ * Start with crc = 0; feeding data in pieces gives the same result as
+ * one call over the concatenation
+ * @param crc CRC of the data so far
+ * @param buf Data to add
+ * @param len Number of bytes
+ * @return CRC of the data so far followed by buf
+ */
+uint32_t rfs_crc32c(uint32_t crc, const void *buf, size_t len);
+
+/**
+ * Combine the CRCs of two adjacent blocks without rereading them
+ * @param crc1 CRC of the first block
+ * @param crc2 CRC of the second block
+ * @param len2 Length of the second block in bytes
+ * @return CRC of the first block followed by the second
+ */
+uint32_t rfs_crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+/**
+ * Precompute the operator for combining with blocks of a fixed length
+ * @param len2 Length of the second block in bytes
+ * @return Operator for rfs_crc32c_combine_op
+ */
+uint32_t rfs_crc32c_combine_gen(size_t len2);
+
+/**
+ * Combine CRCs like rfs_crc32c_combine with a precomputed operator
+ * @param crc1 CRC of the first block
+ * @param crc2 CRC of the second block
+ * @param op Operator from rfs_crc32c_combine_gen for the second block's length
+ * @return CRC of the first block followed by the second
+ */
+uint32_t rfs_crc32c_combine_op(uint32_t crc1, uint32_t crc2, uint32_t op);
+
+/**
+ * Name of the implementation in use
+ * @return "sse4.2" or "slicing-by-8"
+ */
+const char *rfs_crc32c_impl(void);
+
+#endif // RFS_CRC32C_H
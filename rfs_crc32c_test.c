@@ -0,0 +1,121 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_crc32c_test.c -- Known-answer and consistency checks for rfs_crc32c
+ *
+ * Checks the implementation picked at startup against a bitwise
+ * reference over many lengths and alignments, including lengths that
+ * cross the three-lane blocks of the SSE4.2 path, and checks that
+ * combining CRCs matches hashing the concatenated data. `make check`
+ * runs it once as built and once with -DRFS_CRC32C_NO_HW so the table
+ * implementation is covered on CPUs that have SSE4.2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rfs_crc32c.h"
+
+#define MAX_LEN (4 * 3 * 1024 + 64)  // Several interleaved blocks plus a tail
+
+static int failures = 0;
+static int checks = 0;
+
+/**
+ * Bitwise CRC32C, the reference the fast paths are checked against
+ */
+static uint32_t reference_crc32c(const unsigned char *p, size_t len) {
+    uint32_t crc = 0xffffffff;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * Record one check, reporting it if it failed
+ */
+static void expect(const char *what, size_t a, size_t b, uint32_t got, uint32_t want) {
+    checks++;
+    if (got != want) {
+        failures++;
+        if (failures <= 10) {
+            fprintf(stderr, "FAIL %s (%zu, %zu): got %08x, want %08x\n", what, a, b, got, want);
+        }
+    }
+}
+
+/**
+ * Run the checks
+ *
+ * @param argc Number of command-line arguments
+ * @param argv Optional name of the implementation that must be in use
+ * @return 0 if every check passed, 1 otherwise
+ */
+int main(int argc, char *argv[]) {
+    const char *impl = rfs_crc32c_impl();
+    if (argc > 1 && strcmp(impl, argv[1]) != 0) {
+        fprintf(stderr, "FAIL expected the %s implementation, got %s\n", argv[1], impl);
+        return 1;
+    }
+
+    // Known answers
+    expect("check value", 9, 0, rfs_crc32c(0, "123456789", 9), 0xe3069283);
+    expect("empty", 0, 0, rfs_crc32c(0, "", 0), 0);
+    unsigned char zeros[32] = { 0 };
+    expect("32 zeros", 32, 0, rfs_crc32c(0, zeros, sizeof(zeros)), 0x8a9136aa);
+
+    // Pseudo-random data, reproducible between runs
+    unsigned char *data = malloc(MAX_LEN + 8);
+    if (!data) return 1;
+    uint32_t seed = 1;
+    for (size_t i = 0; i < MAX_LEN + 8; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+
+    // Every length up to a few blocks at one alignment, and every
+    // alignment at lengths around the block boundaries
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        expect("length", len, 0, rfs_crc32c(0, data, len), reference_crc32c(data, len));
+    }
+    size_t edges[] = { 3 * 1024 - 1, 3 * 1024, 3 * 1024 + 1, 6 * 1024 + 7, 8192 };
+    for (size_t offset = 1; offset < 8; offset++) {
+        for (size_t e = 0; e < sizeof(edges) / sizeof(edges[0]); e++) {
+            expect("alignment", offset, edges[e],
+                   rfs_crc32c(0, data + offset, edges[e]), reference_crc32c(data + offset, edges[e]));
+        }
+    }
+
+    // Splitting the data anywhere must not change the result, and
+    // combining the two halves' CRCs must give the whole CRC
+    for (size_t split = 0; split <= 8192; split += 61) {
+        size_t len = 8192;
+        uint32_t whole = reference_crc32c(data, len);
+        uint32_t first = rfs_crc32c(0, data, split);
+        uint32_t second = rfs_crc32c(0, data + split, len - split);
+        expect("incremental", split, len, rfs_crc32c(first, data + split, len - split), whole);
+        expect("combine", split, len, rfs_crc32c_combine(first, second, len - split), whole);
+        expect("combine_op", split, len,
+               rfs_crc32c_combine_op(first, second, rfs_crc32c_combine_gen(len - split)), whole);
+    }
+
+    // Chunked whole-file digests as the protocol builds them
+    uint32_t digest = 0;
+    uint32_t op = rfs_crc32c_combine_gen(1024);
+    for (size_t off = 0; off < MAX_LEN; off += 1024) {
+        size_t len = MAX_LEN - off < 1024 ? MAX_LEN - off : 1024;
+        uint32_t crc = rfs_crc32c(0, data + off, len);
+        digest = len == 1024 ? rfs_crc32c_combine_op(digest, crc, op) : rfs_crc32c_combine(digest, crc, len);
+    }
+    expect("chunked digest", MAX_LEN, 1024, digest, reference_crc32c(data, MAX_LEN));
+
+    free(data);
+    printf("crc32c (%s): %d/%d checks passed\n", impl, checks - failures, checks);
+    return failures ? 1 : 0;
+}
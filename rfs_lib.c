@@ -0,0 +1,908 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_lib.c -- Embeddable asynchronous RFS client library
+ *
+ * Requests are queued on the client and picked up by a fixed pool of
+ * worker threads. Each worker keeps one connection open and runs its
+ * requests back to back over it, so a busy caller pays for connect() once
+ * per worker rather than once per request.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include "rfs.h"
+#include "rfs_lib.h"
+#include "rfs_crc32c.h"
+
+/* Worker threads and request completion */
+#include <pthread.h>
+
+#define RFS_DEFAULT_CONNECTIONS 4
+#define RFS_DEFAULT_TIMEOUT_MS 30000
+
+/**
+ * Built-in source/sink state for local files
+ */
+typedef struct {
+    FILE *file;                   // Open file, NULL until opened
+    const char *path;             // Local file path
+} FileStream;
+
+/**
+ * Built-in source/sink state for memory buffers
+ */
+typedef struct {
+    const char *in;               // Upload data (borrowed from the caller)
+    size_t in_len;                // Upload length
+    size_t in_pos;                // Bytes already produced
+    char *out;                    // Download data (owned by the request)
+    size_t out_len;               // Bytes received so far
+} BufferStream;
+
+typedef struct RfsWorker RfsWorker;
+
+/**
+ * Request handle shared between the submitter and the client
+ */
+struct RfsRequest {
+    Command cmd;                  // Command sent to the server
+    RfsSource source;             // Upload source (WRITE)
+    RfsSink sink;                 // Download sink (GET)
+    FileStream file_stream;       // Backing state for file sources/sinks
+    BufferStream buffer_stream;   // Backing state for buffer sources/sinks
+    RfsCallback callback;         // Completion callback, may be NULL
+    void *user_data;              // Passed to the callback
+    RfsClient *client;            // Owning client
+
+    // Guarded by client->lock
+    RfsRequest *next;             // Next request in the client queue
+    RfsWorker *worker;            // Worker running this request, NULL if none
+    int queued;                   // Request is waiting in the client queue
+    int canceled;                 // Cancellation was requested
+
+    // Guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t done;          // Signalled when status leaves RFS_PENDING
+    RfsStatus status;             // Final status, RFS_PENDING until complete
+    int refs;                     // Submitter + client references
+};
+
+/**
+ * Worker thread owning one pooled connection
+ */
+struct RfsWorker {
+    RfsClient *client;            // Owning client
+    pthread_t thread;             // Worker thread
+    int sock;                     // Pooled connection, -1 if not connected (guarded by client->lock)
+};
+
+/**
+ * Client state: configuration, request queue and worker pool
+ */
+struct RfsClient {
+    struct sockaddr_in server_addr;  // Resolved server address
+    int timeout_ms;               // Connect and I/O inactivity timeout, 0 = none
+    int connections;              // Number of workers
+    RfsWorker *workers;           // Worker pool
+
+    pthread_mutex_t lock;         // Guards the queue, shutdown and worker sockets
+    pthread_cond_t queue_cond;    // Signalled when work arrives or on shutdown
+    RfsRequest *queue_head;       // Oldest queued request
+    RfsRequest *queue_tail;       // Newest queued request
+    int shutdown;                 // Client is being destroyed
+};
+
+/*
+ * File and buffer sources/sinks
+ */
+
+static int file_source_open(void *ctx, long *size) {
+    FileStream *stream = ctx;
+    stream->file = fopen(stream->path, "rb");
+    if (!stream->file) return -1;
+
+    // Determine file size
+    fseek(stream->file, 0, SEEK_END);
+    *size = ftell(stream->file);
+    rewind(stream->file);
+    if (*size < 0) {
+        fclose(stream->file);
+        stream->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static long file_source_read(void *ctx, void *buf, size_t len) {
+    FileStream *stream = ctx;
+    size_t bytes_read = fread(buf, 1, len, stream->file);
+    if (bytes_read == 0 && ferror(stream->file)) return -1;
+    return bytes_read;
+}
+
+static void file_source_close(void *ctx, int ok) {
+    FileStream *stream = ctx;
+    fclose(stream->file);
+    stream->file = NULL;
+}
+
+static int file_sink_open(void *ctx, long size) {
+    FileStream *stream = ctx;
+
+    // Create directory path if it doesn't exist
+    char dir_path[PATH_MAX];
+    snprintf(dir_path, sizeof(dir_path), "%s", stream->path);
+    char *last_slash = strrchr(dir_path, '/');
+    if (last_slash) {
+        *last_slash = '\0';
+        mkdir(dir_path, 0755);
+    }
+
+    stream->file = fopen(stream->path, "wb");
+    return stream->file ? 0 : -1;
+}
+
+static int file_sink_write(void *ctx, const void *buf, size_t len) {
+    FileStream *stream = ctx;
+    return fwrite(buf, 1, len, stream->file) == len ? 0 : -1;
+}
+
+static void file_sink_close(void *ctx, int ok) {
+    FileStream *stream = ctx;
+    if (fclose(stream->file) != 0) ok = 0;
+    stream->file = NULL;
+
+    // Don't leave a truncated download behind
+    if (!ok) unlink(stream->path);
+}
+
+static int buffer_source_open(void *ctx, long *size) {
+    BufferStream *stream = ctx;
+    stream->in_pos = 0;
+    *size = stream->in_len;
+    return 0;
+}
+
+static long buffer_source_read(void *ctx, void *buf, size_t len) {
+    BufferStream *stream = ctx;
+    size_t remaining = stream->in_len - stream->in_pos;
+    if (len > remaining) len = remaining;
+    memcpy(buf, stream->in + stream->in_pos, len);
+    stream->in_pos += len;
+    return len;
+}
+
+static int buffer_sink_open(void *ctx, long size) {
+    BufferStream *stream = ctx;
+    free(stream->out);
+    stream->out_len = 0;
+    stream->out = malloc(size > 0 ? size : 1);
+    return stream->out ? 0 : -1;
+}
+
+static int buffer_sink_write(void *ctx, const void *buf, size_t len) {
+    BufferStream *stream = ctx;
+    memcpy(stream->out + stream->out_len, buf, len);
+    stream->out_len += len;
+    return 0;
+}
+
+/*
+ * Payload transfer
+ */
+
+/**
+ * io_status - Map the errno of a failed socket call to a status
+ */
+static RfsStatus io_status(void) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? RFS_ERR_TIMEOUT : RFS_ERR_IO;
+}
+
+/**
+ * send_payload - Send a payload from an opened source
+ * @socket: Connected socket descriptor
+ * @source: Opened source producing exactly @size bytes
+ * @size: Payload size reported by the source
+ *
+ * Each chunk goes out in one send with its CRC32C appended.
+ * Returns RFS_OK on success; on failure the stream is out of sync
+ */
+static RfsStatus send_payload(int socket, RfsSource *source, long size) {
+    if (rfs_send_all(socket, &size, sizeof(size)) < 0) {
+        return io_status();
+    }
+
+    char buffer[BUFFER_SIZE + sizeof(uint32_t)];
+    PayloadDigest digest;
+    rfs_digest_init(&digest);
+    long bytes_sent = 0;
+    while (bytes_sent < size) {
+        size_t chunk_size = (size - bytes_sent > BUFFER_SIZE)
+            ? BUFFER_SIZE : (size - bytes_sent);
+
+        // Chunk boundaries are part of the protocol, so fill the chunk completely
+        size_t filled = 0;
+        while (filled < chunk_size) {
+            long bytes_read = source->read(source->ctx, buffer + filled, chunk_size - filled);
+            if (bytes_read <= 0 || bytes_read > (long)(chunk_size - filled)) {
+                return RFS_ERR_IO;
+            }
+            filled += bytes_read;
+        }
+
+        uint32_t crc = rfs_crc32c(0, buffer, chunk_size);
+        memcpy(buffer + chunk_size, &crc, sizeof(crc));
+        if (rfs_send_all(socket, buffer, chunk_size + sizeof(crc)) < 0) {
+            return io_status();
+        }
+        rfs_digest_add(&digest, crc, chunk_size);
+        bytes_sent += chunk_size;
+    }
+
+    if (rfs_send_all(socket, &digest.file_crc, sizeof(digest.file_crc)) < 0) {
+        return io_status();
+    }
+    return RFS_OK;
+}
+
+/**
+ * receive_payload - Receive and verify a payload into a sink
+ * @socket: Connected socket descriptor
+ * @sink: Sink to open, fill and close
+ * @keep: Set to 1 if the connection is still in sync afterwards
+ *
+ * Chunks reach the sink only after their CRC32C checks out. A failing
+ * sink or a corrupt chunk does not abort the transfer; the rest of the
+ * payload is drained so the connection can be reused.
+ * Returns RFS_OK on success, RFS_ERR_REMOTE if the server had no file,
+ * RFS_ERR_INTEGRITY if verification failed
+ */
+static RfsStatus receive_payload(int socket, RfsSink *sink, int *keep) {
+    *keep = 0;
+
+    long size;
+    ssize_t received = rfs_recv_all(socket, &size, sizeof(size));
+    if (received != sizeof(size)) {
+        return received < 0 ? io_status() : RFS_ERR_IO;
+    }
+    if (size < 0) {
+        *keep = 1;
+        return RFS_ERR_REMOTE;
+    }
+
+    int sink_ok = !sink->open || sink->open(sink->ctx, size) == 0;
+    int opened = sink_ok;
+    int intact = 1;
+
+    char buffer[BUFFER_SIZE + sizeof(uint32_t)];
+    PayloadDigest digest;
+    rfs_digest_init(&digest);
+    long bytes_received = 0;
+    RfsStatus status = RFS_OK;
+    while (bytes_received < size) {
+        size_t chunk_size = (size - bytes_received > BUFFER_SIZE)
+            ? BUFFER_SIZE : (size - bytes_received);
+        received = rfs_recv_all(socket, buffer, chunk_size + sizeof(uint32_t));
+        if (received != (ssize_t)(chunk_size + sizeof(uint32_t))) {
+            status = received < 0 ? io_status() : RFS_ERR_IO;
+            break;
+        }
+
+        uint32_t expected;
+        memcpy(&expected, buffer + chunk_size, sizeof(expected));
+        uint32_t crc = rfs_crc32c(0, buffer, chunk_size);
+        if (crc != expected) {
+            intact = 0;
+        }
+        rfs_digest_add(&digest, crc, chunk_size);
+
+        if (intact && sink_ok && sink->write(sink->ctx, buffer, chunk_size) < 0) {
+            sink_ok = 0;
+        }
+        bytes_received += chunk_size;
+    }
+
+    if (status == RFS_OK) {
+        uint32_t file_crc;
+        received = rfs_recv_all(socket, &file_crc, sizeof(file_crc));
+        if (received != sizeof(file_crc)) {
+            status = received < 0 ? io_status() : RFS_ERR_IO;
+        } else {
+            *keep = 1;
+            if (!intact || file_crc != digest.file_crc) status = RFS_ERR_INTEGRITY;
+            else if (!sink_ok) status = RFS_ERR_IO;
+        }
+    }
+    if (opened && sink->close) {
+        sink->close(sink->ctx, status == RFS_OK);
+    }
+    return status;
+}
+
+/*
+ * Connection pool
+ */
+
+/**
+ * connect_server - Open a connection honouring the configured timeout
+ * @client: Client whose server address and timeout are used
+ *
+ * Returns the connected socket, or -1 with errno set
+ */
+static int connect_server(RfsClient *client) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    int enable = 1;
+#ifdef SO_NOSIGPIPE
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+    // Commands and sizes are small writes followed by a read; don't let
+    // Nagle hold them back waiting for a delayed ACK
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    if (client->timeout_ms > 0) {
+        struct timeval tv;
+        tv.tv_sec = client->timeout_ms / 1000;
+        tv.tv_usec = (client->timeout_ms % 1000) * 1000;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        // Non-blocking connect so the timeout also bounds the handshake
+        int flags = fcntl(sock, F_GETFL, 0);
+        fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+        int rc = connect(sock, (struct sockaddr*)&client->server_addr, sizeof(client->server_addr));
+        if (rc < 0 && errno == EINPROGRESS) {
+            struct pollfd pfd = { sock, POLLOUT, 0 };
+            rc = poll(&pfd, 1, client->timeout_ms);
+            if (rc == 0) {
+                errno = ETIMEDOUT;
+                rc = -1;
+            } else if (rc > 0) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len);
+                errno = err;
+                rc = err ? -1 : 0;
+            }
+        }
+        if (rc < 0) {
+            int saved = errno;
+            close(sock);
+            errno = saved;
+            return -1;
+        }
+        fcntl(sock, F_SETFL, flags);
+    } else if (connect(sock, (struct sockaddr*)&client->server_addr, sizeof(client->server_addr)) < 0) {
+        int saved = errno;
+        close(sock);
+        errno = saved;
+        return -1;
+    }
+
+    return sock;
+}
+
+/**
+ * worker_connection - Return the worker's pooled connection, (re)connecting if needed
+ * @worker: Worker about to run a request
+ *
+ * A pooled connection the server has closed is detected with a
+ * non-blocking peek and replaced before it can fail a request.
+ * Returns the socket, or -1 on error
+ */
+static int worker_connection(RfsWorker *worker) {
+    RfsClient *client = worker->client;
+
+    if (worker->sock >= 0) {
+        char probe;
+        ssize_t rc = recv(worker->sock, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return worker->sock;
+        }
+
+        // Closed by the peer, or unexpected bytes on an idle connection
+        pthread_mutex_lock(&client->lock);
+        close(worker->sock);
+        worker->sock = -1;
+        pthread_mutex_unlock(&client->lock);
+    }
+
+    int sock = connect_server(client);
+    pthread_mutex_lock(&client->lock);
+    worker->sock = sock;
+    pthread_mutex_unlock(&client->lock);
+    return sock;
+}
+
+/*
+ * Request execution
+ */
+
+/**
+ * execute_request - Run one request over a connected socket
+ * @req: Request to run
+ * @sock: Connected socket descriptor
+ * @keep: Set to 1 if the connection is still in sync afterwards
+ *
+ * Returns the request status
+ */
+static RfsStatus execute_request(RfsRequest *req, int sock, int *keep) {
+    *keep = 0;
+
+    switch (req->cmd.type) {
+        case CMD_WRITE: {
+            // Open the source first so a local failure leaves the stream untouched
+            long size = 0;
+            RfsSource *source = &req->source;
+            if (source->open(source->ctx, &size) < 0) {
+                *keep = 1;
+                return RFS_ERR_IO;
+            }
+
+            RfsStatus status = RFS_OK;
+            if (rfs_send_all(sock, &req->cmd, sizeof(req->cmd)) < 0) {
+                status = io_status();
+            } else {
+                status = send_payload(sock, source, size);
+            }
+            if (status == RFS_OK) {
+                int remote_status;
+                ssize_t received = rfs_recv_all(sock, &remote_status, sizeof(remote_status));
+                if (received != sizeof(remote_status)) {
+                    status = received < 0 ? io_status() : RFS_ERR_IO;
+                } else {
+                    *keep = 1;
+                    status = remote_status == 0 ? RFS_OK
+                        : remote_status == RFS_STATUS_CORRUPT ? RFS_ERR_INTEGRITY : RFS_ERR_REMOTE;
+                }
+            }
+            if (source->close) {
+                source->close(source->ctx, status == RFS_OK);
+            }
+            return status;
+        }
+        case CMD_GET:
+            if (rfs_send_all(sock, &req->cmd, sizeof(req->cmd)) < 0) {
+                return io_status();
+            }
+            return receive_payload(sock, &req->sink, keep);
+        case CMD_RM: {
+            if (rfs_send_all(sock, &req->cmd, sizeof(req->cmd)) < 0) {
+                return io_status();
+            }
+            int remote_status;
+            ssize_t received = rfs_recv_all(sock, &remote_status, sizeof(remote_status));
+            if (received != sizeof(remote_status)) {
+                return received < 0 ? io_status() : RFS_ERR_IO;
+            }
+            *keep = 1;
+            return remote_status == 0 ? RFS_OK : RFS_ERR_REMOTE;
+        }
+        default:
+            *keep = 1;
+            return RFS_ERR_IO;
+    }
+}
+
+/**
+ * complete_request - Publish a final status and drop the client's reference
+ * @req: Request that finished
+ * @status: Final status
+ */
+static void complete_request(RfsRequest *req, RfsStatus status) {
+    pthread_mutex_lock(&req->lock);
+    req->status = status;
+    pthread_cond_broadcast(&req->done);
+    pthread_mutex_unlock(&req->lock);
+
+    if (req->callback) {
+        req->callback(req, status, req->user_data);
+    }
+    rfs_request_release(req);
+}
+
+/**
+ * worker_main - Worker thread: run queued requests over a pooled connection
+ * @args: Pointer to the RfsWorker
+ */
+static void *worker_main(void *args) {
+    RfsWorker *worker = args;
+    RfsClient *client = worker->client;
+
+    while (1) {
+        // Wait for the next request
+        pthread_mutex_lock(&client->lock);
+        while (!client->queue_head && !client->shutdown) {
+            pthread_cond_wait(&client->queue_cond, &client->lock);
+        }
+        RfsRequest *req = client->queue_head;
+        if (!req) {
+            pthread_mutex_unlock(&client->lock);
+            break;
+        }
+        client->queue_head = req->next;
+        if (!client->queue_head) client->queue_tail = NULL;
+        req->next = NULL;
+        req->queued = 0;
+        if (client->shutdown) {
+            // The client is being destroyed: fail what is left in the queue
+            pthread_mutex_unlock(&client->lock);
+            complete_request(req, RFS_ERR_CANCELED);
+            continue;
+        }
+        req->worker = worker;
+        pthread_mutex_unlock(&client->lock);
+
+        RfsStatus status;
+        int keep = 0;
+        int sock = worker_connection(worker);
+
+        // Don't start a transfer that was cancelled while connecting
+        pthread_mutex_lock(&client->lock);
+        int canceled = req->canceled || client->shutdown;
+        pthread_mutex_unlock(&client->lock);
+
+        if (canceled) {
+            status = RFS_ERR_CANCELED;
+        } else if (sock < 0) {
+            status = (errno == ETIMEDOUT) ? RFS_ERR_TIMEOUT : RFS_ERR_CONNECT;
+        } else {
+            status = execute_request(req, sock, &keep);
+        }
+
+        // A cancelled transfer had its socket shut down; never reuse it
+        pthread_mutex_lock(&client->lock);
+        req->worker = NULL;
+        if (req->canceled || client->shutdown) {
+            keep = 0;
+            if (status != RFS_OK) status = RFS_ERR_CANCELED;
+        }
+        if (!keep && worker->sock >= 0) {
+            close(worker->sock);
+            worker->sock = -1;
+        }
+        pthread_mutex_unlock(&client->lock);
+
+        complete_request(req, status);
+    }
+
+    return NULL;
+}
+
+/*
+ * Public API
+ */
+
+void rfs_client_config_init(RfsClientConfig *config) {
+    memset(config, 0, sizeof(RfsClientConfig));
+    config->host = "127.0.0.1";
+    config->port = PORT;
+    config->connections = RFS_DEFAULT_CONNECTIONS;
+    config->timeout_ms = RFS_DEFAULT_TIMEOUT_MS;
+}
+
+RfsClient *rfs_client_create(const RfsClientConfig *config) {
+    RfsClientConfig defaults;
+    if (!config) {
+        rfs_client_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->connections <= 0 || config->timeout_ms < 0) {
+        return NULL;
+    }
+
+    RfsClient *client = calloc(1, sizeof(RfsClient));
+    if (!client) return NULL;
+
+    client->server_addr.sin_family = AF_INET;
+    client->server_addr.sin_port = htons(config->port);
+    if (inet_pton(AF_INET, config->host ? config->host : "127.0.0.1", &client->server_addr.sin_addr) != 1) {
+        free(client);
+        return NULL;
+    }
+    client->timeout_ms = config->timeout_ms;
+    client->connections = config->connections;
+    pthread_mutex_init(&client->lock, NULL);
+    pthread_cond_init(&client->queue_cond, NULL);
+
+    client->workers = calloc(client->connections, sizeof(RfsWorker));
+    if (!client->workers) {
+        free(client);
+        return NULL;
+    }
+
+    // Start worker threads; on failure stop the ones already running
+    for (int i = 0; i < client->connections; i++) {
+        client->workers[i].client = client;
+        client->workers[i].sock = -1;
+        if (pthread_create(&client->workers[i].thread, NULL, worker_main, &client->workers[i]) != 0) {
+            client->connections = i;
+            rfs_client_destroy(client);
+            return NULL;
+        }
+    }
+
+    return client;
+}
+
+void rfs_client_destroy(RfsClient *client) {
+    if (!client) return;
+
+    // Stop accepting work; the workers fail whatever is still queued
+    pthread_mutex_lock(&client->lock);
+    client->shutdown = 1;
+
+    // Abort in-flight transfers
+    for (int i = 0; i < client->connections; i++) {
+        if (client->workers[i].sock >= 0) {
+            shutdown(client->workers[i].sock, SHUT_RDWR);
+        }
+    }
+    pthread_cond_broadcast(&client->queue_cond);
+    pthread_mutex_unlock(&client->lock);
+
+    for (int i = 0; i < client->connections; i++) {
+        pthread_join(client->workers[i].thread, NULL);
+        if (client->workers[i].sock >= 0) {
+            close(client->workers[i].sock);
+        }
+    }
+
+    pthread_cond_destroy(&client->queue_cond);
+    pthread_mutex_destroy(&client->lock);
+    free(client->workers);
+    free(client);
+}
+
+/**
+ * request_create - Allocate a request for @type on @remote_path
+ *
+ * Returns the request holding submitter and client references, or NULL
+ */
+static RfsRequest *request_create(RfsClient *client, CommandType type, const char *remote_path,
+                                  RfsCallback callback, void *user_data) {
+    if (!client || !remote_path || strlen(remote_path) >= PATH_MAX) {
+        return NULL;
+    }
+
+    RfsRequest *req = calloc(1, sizeof(RfsRequest));
+    if (!req) return NULL;
+
+    req->cmd.type = type;
+    strncpy(req->cmd.remote_path, remote_path, sizeof(req->cmd.remote_path) - 1);
+    req->callback = callback;
+    req->user_data = user_data;
+    req->client = client;
+    req->status = RFS_PENDING;
+    req->refs = 2;
+    pthread_mutex_init(&req->lock, NULL);
+    pthread_cond_init(&req->done, NULL);
+    return req;
+}
+
+/**
+ * request_free - Release a request's resources
+ */
+static void request_free(RfsRequest *req) {
+    pthread_cond_destroy(&req->done);
+    pthread_mutex_destroy(&req->lock);
+    free(req->buffer_stream.out);
+    free(req);
+}
+
+/**
+ * request_submit - Queue a request for the workers
+ *
+ * Returns @req, or NULL (freeing it) if the client is shutting down
+ */
+static RfsRequest *request_submit(RfsRequest *req) {
+    RfsClient *client = req->client;
+
+    pthread_mutex_lock(&client->lock);
+    if (client->shutdown) {
+        pthread_mutex_unlock(&client->lock);
+        request_free(req);
+        return NULL;
+    }
+    if (client->queue_tail) {
+        client->queue_tail->next = req;
+    } else {
+        client->queue_head = req;
+    }
+    client->queue_tail = req;
+    req->queued = 1;
+    pthread_cond_signal(&client->queue_cond);
+    pthread_mutex_unlock(&client->lock);
+
+    return req;
+}
+
+RfsRequest *rfs_write_file(RfsClient *client, const char *local_path, const char *remote_path,
+                           RfsCallback callback, void *user_data) {
+    if (!local_path || strlen(local_path) >= PATH_MAX) return NULL;
+
+    RfsRequest *req = request_create(client, CMD_WRITE, remote_path, callback, user_data);
+    if (!req) return NULL;
+
+    strncpy(req->cmd.local_path, local_path, sizeof(req->cmd.local_path) - 1);
+    req->file_stream.path = req->cmd.local_path;
+    RfsSource source = { file_source_open, file_source_read, file_source_close, &req->file_stream };
+    req->source = source;
+    return request_submit(req);
+}
+
+RfsRequest *rfs_write_buffer(RfsClient *client, const void *data, size_t len, const char *remote_path,
+                             RfsCallback callback, void *user_data) {
+    if (!data && len > 0) return NULL;
+
+    RfsRequest *req = request_create(client, CMD_WRITE, remote_path, callback, user_data);
+    if (!req) return NULL;
+
+    req->buffer_stream.in = data;
+    req->buffer_stream.in_len = len;
+    RfsSource source = { buffer_source_open, buffer_source_read, NULL, &req->buffer_stream };
+    req->source = source;
+    return request_submit(req);
+}
+
+RfsRequest *rfs_write_source(RfsClient *client, const RfsSource *source, const char *remote_path,
+                             RfsCallback callback, void *user_data) {
+    // Without open() there is no size to announce
+    if (!source || !source->open || !source->read) return NULL;
+
+    RfsRequest *req = request_create(client, CMD_WRITE, remote_path, callback, user_data);
+    if (!req) return NULL;
+
+    req->source = *source;
+    return request_submit(req);
+}
+
+RfsRequest *rfs_get_file(RfsClient *client, const char *remote_path, const char *local_path,
+                         RfsCallback callback, void *user_data) {
+    if (!local_path || strlen(local_path) >= PATH_MAX) return NULL;
+
+    RfsRequest *req = request_create(client, CMD_GET, remote_path, callback, user_data);
+    if (!req) return NULL;
+
+    strncpy(req->cmd.local_path, local_path, sizeof(req->cmd.local_path) - 1);
+    req->file_stream.path = req->cmd.local_path;
+    RfsSink sink = { file_sink_open, file_sink_write, file_sink_close, &req->file_stream };
+    req->sink = sink;
+    return request_submit(req);
+}
+
+RfsRequest *rfs_get_buffer(RfsClient *client, const char *remote_path,
+                           RfsCallback callback, void *user_data) {
+    RfsRequest *req = request_create(client, CMD_GET, remote_path, callback, user_data);
+    if (!req) return NULL;
+
+    RfsSink sink = { buffer_sink_open, buffer_sink_write, NULL, &req->buffer_stream };
+    req->sink = sink;
+    return request_submit(req);
+}
+
+RfsRequest *rfs_get_sink(RfsClient *client, const char *remote_path, const RfsSink *sink,
+                         RfsCallback callback, void *user_data) {
+    if (!sink || !sink->write) return NULL;
+
+    RfsRequest *req = request_create(client, CMD_GET, remote_path, callback, user_data);
+    if (!req) return NULL;
+
+    req->sink = *sink;
+    return request_submit(req);
+}
+
+RfsRequest *rfs_rm(RfsClient *client, const char *remote_path,
+                   RfsCallback callback, void *user_data) {
+    RfsRequest *req = request_create(client, CMD_RM, remote_path, callback, user_data);
+    if (!req) return NULL;
+
+    return request_submit(req);
+}
+
+RfsStatus rfs_request_status(RfsRequest *req) {
+    pthread_mutex_lock(&req->lock);
+    RfsStatus status = req->status;
+    pthread_mutex_unlock(&req->lock);
+    return status;
+}
+
+RfsStatus rfs_request_wait(RfsRequest *req, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&req->lock);
+    while (req->status == RFS_PENDING) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&req->done, &req->lock);
+        } else if (pthread_cond_timedwait(&req->done, &req->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    RfsStatus status = req->status;
+    pthread_mutex_unlock(&req->lock);
+    return status;
+}
+
+int rfs_request_cancel(RfsRequest *req) {
+    RfsClient *client = req->client;
+
+    pthread_mutex_lock(&client->lock);
+    if (req->queued) {
+        // Still queued: unlink and complete it right here
+        RfsRequest **link = &client->queue_head;
+        RfsRequest *prev = NULL;
+        while (*link != req) {
+            prev = *link;
+            link = &(*link)->next;
+        }
+        *link = req->next;
+        if (client->queue_tail == req) client->queue_tail = prev;
+        req->next = NULL;
+        req->queued = 0;
+        pthread_mutex_unlock(&client->lock);
+
+        complete_request(req, RFS_ERR_CANCELED);
+        return 0;
+    }
+    if (req->worker) {
+        // In flight: unblock the worker's socket I/O, it reports the cancellation
+        req->canceled = 1;
+        if (req->worker->sock >= 0) {
+            shutdown(req->worker->sock, SHUT_RDWR);
+        }
+        pthread_mutex_unlock(&client->lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&client->lock);
+    return -1;
+}
+
+const void *rfs_request_data(RfsRequest *req, size_t *len) {
+    if (len) *len = req->buffer_stream.out_len;
+    return req->buffer_stream.out;
+}
+
+void rfs_request_release(RfsRequest *req) {
+    if (!req) return;
+
+    pthread_mutex_lock(&req->lock);
+    int refs = --req->refs;
+    pthread_mutex_unlock(&req->lock);
+    if (refs == 0) {
+        request_free(req);
+    }
+}
+
+const char *rfs_strerror(RfsStatus status) {
+    switch (status) {
+        case RFS_OK:             return "success";
+        case RFS_PENDING:        return "request pending";
+        case RFS_ERR_IO:         return "I/O error";
+        case RFS_ERR_REMOTE:     return "server rejected request";
+        case RFS_ERR_TIMEOUT:    return "timed out";
+        case RFS_ERR_CANCELED:   return "request cancelled";
+        case RFS_ERR_CONNECT:    return "unable to connect to server";
+        case RFS_ERR_INTEGRITY:  return "checksum mismatch";
+        default:                 return "unknown error";
+    }
+}
@@ -0,0 +1,263 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_lib.h - Embeddable asynchronous client library for RFS (librfs.a)
+ *
+ * An RfsClient owns a small pool of worker threads, each holding one
+ * persistent connection to the server. Submitting a request never blocks:
+ * it is queued and a handle is returned at once. Completion is reported
+ * through an optional callback (run on a worker thread) and can also be
+ * awaited, polled or cancelled through the handle.
+ *
+ * Typical use:
+ *   RfsClientConfig config;
+ *   rfs_client_config_init(&config);
+ *   RfsClient *client = rfs_client_create(&config);
+ *   RfsRequest *req = rfs_get_buffer(client, "remote/a.txt", NULL, NULL);
+ *   if (rfs_request_wait(req, -1) == RFS_OK) {
+ *       size_t len;
+ *       const void *data = rfs_request_data(req, &len);
+ *       ...
+ *   }
+ *   rfs_request_release(req);
+ *   rfs_client_destroy(client);
+ */
+
+#ifndef RFS_LIB_H
+#define RFS_LIB_H
+
+#include <stddef.h>
+
+/**
+ * Completion status of a request
+ * Negative values are failures
+ */
+typedef enum {
+    RFS_OK = 0,             // Request completed successfully
+    RFS_PENDING = 1,        // Request is queued or in flight
+    RFS_ERR_IO = -1,        // Socket or local source/sink failure
+    RFS_ERR_REMOTE = -2,    // Server rejected the request (e.g. missing file)
+    RFS_ERR_TIMEOUT = -3,   // Connect or transfer exceeded the configured timeout
+    RFS_ERR_CANCELED = -4,  // Request was cancelled before it completed
+    RFS_ERR_CONNECT = -5,   // Unable to connect to the server
+    RFS_ERR_INTEGRITY = -6  // Data failed CRC32C verification in transit or at rest
+} RfsStatus;
+
+typedef struct RfsClient RfsClient;
+typedef struct RfsRequest RfsRequest;
+
+/**
+ * Completion callback, invoked once per request on a worker thread
+ * The one exception is a queued request cancelled with rfs_request_cancel,
+ * whose callback runs on the cancelling thread before the call returns.
+ * The request handle stays valid for the duration of the call even if the
+ * submitter already released it. Callbacks must not block for long since
+ * they delay the next request on that connection.
+ */
+typedef void (*RfsCallback)(RfsRequest *req, RfsStatus status, void *user_data);
+
+/**
+ * Client configuration
+ * Initialize with rfs_client_config_init() and override fields as needed
+ */
+typedef struct {
+    const char *host;   // Server IPv4 address (default "127.0.0.1")
+    int port;           // Server port (default PORT)
+    int connections;    // Pooled connections, one worker thread each (default 4)
+    int timeout_ms;     // Connect and per-I/O inactivity timeout, 0 = none (default 30000)
+} RfsClientConfig;
+
+/**
+ * Data source for uploads
+ * open() reports the total size up front; read() is then called until the
+ * size has been produced. close() is always called once open() succeeded,
+ * with ok set when the transfer completed. open and read are required;
+ * close is optional.
+ */
+typedef struct {
+    int (*open)(void *ctx, long *size);
+    long (*read)(void *ctx, void *buf, size_t len);   // bytes read, -1 on error
+    void (*close)(void *ctx, int ok);
+    void *ctx;
+} RfsSource;
+
+/**
+ * Data sink for downloads
+ * open() receives the size announced by the server; write() is then called
+ * with consecutive chunks. close() is always called once open() succeeded,
+ * with ok set when the transfer completed. open and close are optional.
+ */
+typedef struct {
+    int (*open)(void *ctx, long size);
+    int (*write)(void *ctx, const void *buf, size_t len);  // 0 on success, -1 on error
+    void (*close)(void *ctx, int ok);
+    void *ctx;
+} RfsSink;
+
+/**
+ * Fill a configuration with defaults
+ * @param config Configuration to initialize
+ */
+void rfs_client_config_init(RfsClientConfig *config);
+
+/**
+ * Create a client and start its worker threads
+ * Connections are opened lazily by the first request that needs them
+ * @param config Client configuration, NULL for defaults
+ * @return New client, or NULL on error
+ */
+RfsClient *rfs_client_create(const RfsClientConfig *config);
+
+/**
+ * Cancel outstanding requests, stop the workers and free the client
+ * Request handles still held by the caller stay valid until released
+ * @param client Client to destroy
+ */
+void rfs_client_destroy(RfsClient *client);
+
+/*
+ * Request submission
+ * Every submit function returns a handle owned by the caller, who must
+ * release it with rfs_request_release() (immediately is fine when only the
+ * callback matters). NULL is returned for invalid arguments, allocation
+ * failure or a client that is shutting down; the callback is not invoked.
+ */
+
+/**
+ * Upload a local file
+ * @param client Client to submit on
+ * @param local_path Path of the file to upload
+ * @param remote_path Destination path on the server
+ * @param callback Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ * @return Request handle, or NULL on error
+ */
+RfsRequest *rfs_write_file(RfsClient *client, const char *local_path, const char *remote_path,
+                           RfsCallback callback, void *user_data);
+
+/**
+ * Upload an in-memory buffer
+ * The buffer is not copied and must stay valid until the request completes
+ * @param client Client to submit on
+ * @param data Bytes to upload
+ * @param len Number of bytes
+ * @param remote_path Destination path on the server
+ * @param callback Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ * @return Request handle, or NULL on error
+ */
+RfsRequest *rfs_write_buffer(RfsClient *client, const void *data, size_t len, const char *remote_path,
+                             RfsCallback callback, void *user_data);
+
+/**
+ * Upload from a caller-provided source
+ * @param client Client to submit on
+ * @param source Source callbacks, copied into the request
+ * @param remote_path Destination path on the server
+ * @param callback Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ * @return Request handle, or NULL on error or if source lacks open or read
+ */
+RfsRequest *rfs_write_source(RfsClient *client, const RfsSource *source, const char *remote_path,
+                             RfsCallback callback, void *user_data);
+
+/**
+ * Download a remote file to a local file
+ * A partially written local file is removed if the transfer fails
+ * @param client Client to submit on
+ * @param remote_path Path on the server
+ * @param local_path Destination path on the local filesystem
+ * @param callback Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ * @return Request handle, or NULL on error
+ */
+RfsRequest *rfs_get_file(RfsClient *client, const char *remote_path, const char *local_path,
+                         RfsCallback callback, void *user_data);
+
+/**
+ * Download a remote file into memory
+ * Retrieve the contents with rfs_request_data() once complete
+ * @param client Client to submit on
+ * @param remote_path Path on the server
+ * @param callback Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ * @return Request handle, or NULL on error
+ */
+RfsRequest *rfs_get_buffer(RfsClient *client, const char *remote_path,
+                           RfsCallback callback, void *user_data);
+
+/**
+ * Download a remote file into a caller-provided sink
+ * @param client Client to submit on
+ * @param remote_path Path on the server
+ * @param sink Sink callbacks, copied into the request
+ * @param callback Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ * @return Request handle, or NULL on error
+ */
+RfsRequest *rfs_get_sink(RfsClient *client, const char *remote_path, const RfsSink *sink,
+                         RfsCallback callback, void *user_data);
+
+/**
+ * Remove a remote file or empty directory
+ * @param client Client to submit on
+ * @param remote_path Path on the server
+ * @param callback Completion callback, may be NULL
+ * @param user_data Passed to the callback
+ * @return Request handle, or NULL on error
+ */
+RfsRequest *rfs_rm(RfsClient *client, const char *remote_path,
+                   RfsCallback callback, void *user_data);
+
+/**
+ * Current status of a request
+ * @param req Request handle
+ * @return RFS_PENDING until the request completes, then its final status
+ */
+RfsStatus rfs_request_status(RfsRequest *req);
+
+/**
+ * Wait for a request to complete
+ * @param req Request handle
+ * @param timeout_ms Maximum time to wait, -1 to wait forever
+ * @return Final status, or RFS_PENDING if the wait timed out
+ */
+RfsStatus rfs_request_wait(RfsRequest *req, int timeout_ms);
+
+/**
+ * Cancel a request
+ * A queued request completes immediately with RFS_ERR_CANCELED; an
+ * in-flight transfer is aborted and its connection re-established. An
+ * in-flight request that had already finished its transfer still
+ * completes with RFS_OK.
+ * Must not be called after the owning client has been destroyed.
+ * @param req Request handle
+ * @return 0 if cancellation was requested, -1 if the request had already completed
+ */
+int rfs_request_cancel(RfsRequest *req);
+
+/**
+ * Contents downloaded by rfs_get_buffer()
+ * The memory belongs to the request and is freed on release
+ * @param req Completed request handle
+ * @param len Set to the number of bytes, may be NULL
+ * @return Pointer to the data, or NULL if there is none
+ */
+const void *rfs_request_data(RfsRequest *req, size_t *len);
+
+/**
+ * Release the caller's reference to a request
+ * @param req Request handle, may be NULL
+ */
+void rfs_request_release(RfsRequest *req);
+
+/**
+ * Human-readable description of a status
+ * @param status Status code
+ * @return Static string
+ */
+const char *rfs_strerror(RfsStatus status);
+
+#endif // RFS_LIB_H
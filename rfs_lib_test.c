@@ -0,0 +1,621 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_lib_test.c -- Round-trip, failure and cancellation checks for librfs
+ *
+ * Runs the library against a small scripted server in the same process,
+ * listening on an ephemeral port, so the checks don't depend on rfserver
+ * or on timing beyond a few short timeouts. The server speaks the real
+ * protocol and keeps uploads in memory. A few remote paths make it
+ * misbehave on purpose:
+ *   stall/...    GET sends the size and one chunk, then stops sending
+ *   corrupt/...  GET sends a chunk whose CRC32C does not match
+ *   drop/...     the server closes the connection without replying
+ * Connect-time behaviour is checked against a listener whose accept
+ * queue is full, so the handshake never completes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "rfs.h"
+#include "rfs_lib.h"
+#include "rfs_crc32c.h"
+
+#define MAX_FILES 32            // Files the scripted server can hold
+#define SHORT_TIMEOUT_MS 200    // Client timeout for the timeout checks
+#define WAIT_MS 5000            // Upper bound on any wait that should succeed
+
+static int failures = 0;
+static int checks = 0;
+
+/**
+ * Record one check, reporting it if it failed
+ */
+static void expect(const char *what, int ok) {
+    checks++;
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "FAIL %s\n", what);
+    }
+}
+
+/**
+ * Record a check on a request status
+ */
+static void expect_status(const char *what, RfsStatus got, RfsStatus want) {
+    checks++;
+    if (got != want) {
+        failures++;
+        fprintf(stderr, "FAIL %s: got %s, want %s\n", what, rfs_strerror(got), rfs_strerror(want));
+    }
+}
+
+/*
+ * Scripted server
+ */
+
+/**
+ * File uploaded to the scripted server
+ */
+typedef struct {
+    char path[PATH_MAX];          // Remote path, empty if the slot is unused
+    char *data;                   // Contents
+    long len;                     // Size in bytes
+} StoredFile;
+
+static struct {
+    int listen_sock;
+    int port;
+    atomic_int accepts;           // Connections accepted so far
+    pthread_mutex_t lock;         // Guards files and stalled
+    pthread_cond_t stalled_cond;  // Signalled when a GET reaches its stall point
+    int stalled;                  // GETs that have stalled so far
+    StoredFile files[MAX_FILES];
+} server;
+
+static StoredFile *find_file(const char *path) {
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (strcmp(server.files[i].path, path) == 0) return &server.files[i];
+    }
+    return NULL;
+}
+
+/**
+ * Receive an upload, checking every chunk CRC and the whole-file CRC
+ *
+ * @param sock Client connection
+ * @param data Set to the received bytes (caller frees)
+ * @param len Set to the payload size
+ * @param intact Set to 0 if a checksum did not match
+ * @return 0 on success, -1 if the connection failed
+ */
+static int receive_upload(int sock, char **data, long *len, int *intact) {
+    if (rfs_recv_all(sock, len, sizeof(*len)) != sizeof(*len) || *len < 0) return -1;
+    *data = malloc(*len > 0 ? *len : 1);
+    *intact = 1;
+
+    char buffer[BUFFER_SIZE + sizeof(uint32_t)];
+    PayloadDigest digest;
+    rfs_digest_init(&digest);
+    for (long done = 0; done < *len; ) {
+        size_t chunk = *len - done > BUFFER_SIZE ? BUFFER_SIZE : *len - done;
+        if (rfs_recv_all(sock, buffer, chunk + sizeof(uint32_t)) != (ssize_t)(chunk + sizeof(uint32_t))) {
+            return -1;
+        }
+        uint32_t crc;
+        memcpy(&crc, buffer + chunk, sizeof(crc));
+        if (crc != rfs_crc32c(0, buffer, chunk)) *intact = 0;
+        rfs_digest_add(&digest, crc, chunk);
+        memcpy(*data + done, buffer, chunk);
+        done += chunk;
+    }
+
+    uint32_t file_crc;
+    if (rfs_recv_all(sock, &file_crc, sizeof(file_crc)) != sizeof(file_crc)) return -1;
+    if (file_crc != digest.file_crc) *intact = 0;
+    return 0;
+}
+
+/**
+ * Send a download payload
+ *
+ * @param sock Client connection
+ * @param data Bytes to send
+ * @param len Payload size announced to the client
+ * @param corrupt Send the first chunk with a wrong CRC
+ * @param stop_after Stop after this many chunks, -1 to send them all
+ * @return 0 on success, -1 if the connection failed
+ */
+static int send_download(int sock, const char *data, long len, int corrupt, int stop_after) {
+    if (rfs_send_all(sock, &len, sizeof(len)) < 0) return -1;
+
+    char buffer[BUFFER_SIZE + sizeof(uint32_t)];
+    PayloadDigest digest;
+    rfs_digest_init(&digest);
+    int chunks = 0;
+    for (long done = 0; done < len; done += BUFFER_SIZE, chunks++) {
+        if (chunks == stop_after) return 0;
+        size_t chunk = len - done > BUFFER_SIZE ? BUFFER_SIZE : len - done;
+        memcpy(buffer, data + done, chunk);
+        uint32_t crc = rfs_crc32c(0, buffer, chunk);
+        rfs_digest_add(&digest, crc, chunk);
+        if (corrupt && done == 0) crc ^= 1;
+        memcpy(buffer + chunk, &crc, sizeof(crc));
+        if (rfs_send_all(sock, buffer, chunk + sizeof(crc)) < 0) return -1;
+    }
+    return rfs_send_all(sock, &digest.file_crc, sizeof(digest.file_crc));
+}
+
+/**
+ * Serve one connection until the client closes it
+ */
+static void *serve_connection(void *arg) {
+    int sock = (int)(intptr_t)arg;
+    static const char pattern[4 * BUFFER_SIZE] = { 0 };
+    Command cmd;
+
+    while (rfs_recv_all(sock, &cmd, sizeof(cmd)) == sizeof(cmd)) {
+        const char *path = cmd.remote_path;
+        if (strncmp(path, "drop/", 5) == 0) break;
+
+        if (cmd.type == CMD_WRITE) {
+            char *data = NULL;
+            long len;
+            int intact;
+            if (receive_upload(sock, &data, &len, &intact) < 0) {
+                free(data);
+                break;
+            }
+            pthread_mutex_lock(&server.lock);
+            StoredFile *file = find_file(path);
+            if (!file) file = find_file("");
+            if (file && intact) {
+                strcpy(file->path, path);
+                free(file->data);
+                file->data = data;
+                file->len = len;
+                data = NULL;
+            }
+            pthread_mutex_unlock(&server.lock);
+            free(data);
+            int status = intact ? 0 : RFS_STATUS_CORRUPT;
+            if (rfs_send_all(sock, &status, sizeof(status)) < 0) break;
+        } else if (cmd.type == CMD_GET && strncmp(path, "stall/", 6) == 0) {
+            // Announce a payload, send part of it, then wait for the client to give up
+            if (send_download(sock, pattern, sizeof(pattern), 0, 1) < 0) break;
+            pthread_mutex_lock(&server.lock);
+            server.stalled++;
+            pthread_cond_broadcast(&server.stalled_cond);
+            pthread_mutex_unlock(&server.lock);
+            char byte;
+            while (recv(sock, &byte, 1, 0) > 0) { }
+            break;
+        } else if (cmd.type == CMD_GET && strncmp(path, "corrupt/", 8) == 0) {
+            if (send_download(sock, pattern, BUFFER_SIZE + 10, 1, -1) < 0) break;
+        } else if (cmd.type == CMD_GET) {
+            // Copy out under the lock; a concurrent WRITE may replace the file
+            pthread_mutex_lock(&server.lock);
+            StoredFile *file = find_file(path);
+            long len = file ? file->len : -1;
+            char *data = file ? malloc(len > 0 ? len : 1) : NULL;
+            if (file) memcpy(data, file->data, len);
+            pthread_mutex_unlock(&server.lock);
+            int rc = file ? send_download(sock, data, len, 0, -1) : rfs_send_all(sock, &len, sizeof(len));
+            free(data);
+            if (rc < 0) break;
+        } else if (cmd.type == CMD_RM) {
+            pthread_mutex_lock(&server.lock);
+            StoredFile *file = find_file(path);
+            if (file) {
+                file->path[0] = '\0';
+                free(file->data);
+                file->data = NULL;
+            }
+            pthread_mutex_unlock(&server.lock);
+            int status = file ? 0 : -1;
+            if (rfs_send_all(sock, &status, sizeof(status)) < 0) break;
+        } else {
+            break;
+        }
+    }
+
+    close(sock);
+    return NULL;
+}
+
+static void *accept_main(void *arg) {
+    while (1) {
+        int sock = accept(server.listen_sock, NULL, NULL);
+        if (sock < 0) continue;
+        atomic_fetch_add(&server.accepts, 1);
+        pthread_t thread;
+        pthread_create(&thread, NULL, serve_connection, (void*)(intptr_t)sock);
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+/**
+ * Open a listening socket on an ephemeral loopback port
+ *
+ * @param backlog listen() backlog
+ * @param port Set to the chosen port
+ * @return The socket, or -1 on error
+ */
+static int listen_loopback(int backlog, int *port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(sock, backlog) < 0 || getsockname(sock, (struct sockaddr*)&addr, &len) < 0) {
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return sock;
+}
+
+/**
+ * Open a listener that completes no further handshakes
+ * Its accept queue is filled and never drained, so the kernel drops new SYNs
+ *
+ * @param port Set to the listener's port
+ * @return 0 on success, -1 on error
+ */
+static int start_full_listener(int *port) {
+    int sock = listen_loopback(0, port);
+    if (sock < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(*port);
+    for (int i = 0; i < 2; i++) {
+        int filler = socket(AF_INET, SOCK_STREAM, 0);
+        fcntl(filler, F_SETFL, O_NONBLOCK);
+        connect(filler, (struct sockaddr*)&addr, sizeof(addr));
+    }
+    usleep(50 * 1000);
+    return 0;
+}
+
+/**
+ * Wait until the scripted server has stalled @count GETs in total
+ *
+ * @return 0 once reached, -1 after WAIT_MS
+ */
+static int wait_stalled(int count) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += WAIT_MS / 1000;
+
+    pthread_mutex_lock(&server.lock);
+    int rc = 0;
+    while (server.stalled < count && rc == 0) {
+        rc = pthread_cond_timedwait(&server.stalled_cond, &server.lock, &deadline);
+    }
+    int reached = server.stalled >= count;
+    pthread_mutex_unlock(&server.lock);
+    return reached ? 0 : -1;
+}
+
+static RfsClient *make_client(int port, int connections, int timeout_ms) {
+    RfsClientConfig config;
+    rfs_client_config_init(&config);
+    config.port = port;
+    config.connections = connections;
+    config.timeout_ms = timeout_ms;
+    return rfs_client_create(&config);
+}
+
+/*
+ * Callbacks, sources and sinks used by the checks
+ */
+
+/**
+ * Completion callback state
+ */
+typedef struct {
+    atomic_int calls;             // Callbacks received
+    pthread_t thread;             // Thread that ran the last callback
+} CallbackLog;
+
+static void log_callback(RfsRequest *req, RfsStatus status, void *user_data) {
+    CallbackLog *log = user_data;
+    log->thread = pthread_self();
+    atomic_fetch_add(&log->calls, 1);
+}
+
+/**
+ * Generated upload: byte i is (i * 7 + seed) & 0xff, produced in odd-sized reads
+ */
+typedef struct {
+    long size;
+    long pos;
+    int seed;
+    int closed_ok;                // -1 until close() is called
+} PatternSource;
+
+static int pattern_open(void *ctx, long *size) {
+    PatternSource *source = ctx;
+    source->pos = 0;
+    *size = source->size;
+    return 0;
+}
+
+static long pattern_read(void *ctx, void *buf, size_t len) {
+    PatternSource *source = ctx;
+    if (len > 1000) len = 1000;
+    if (len > (size_t)(source->size - source->pos)) len = source->size - source->pos;
+    for (size_t i = 0; i < len; i++) {
+        ((unsigned char*)buf)[i] = ((source->pos + i) * 7 + source->seed) & 0xff;
+    }
+    source->pos += len;
+    return len;
+}
+
+static void pattern_close(void *ctx, int ok) {
+    ((PatternSource*)ctx)->closed_ok = ok;
+}
+
+/**
+ * Download checked against the pattern as it arrives
+ */
+typedef struct {
+    long announced;               // Size passed to open()
+    long pos;
+    int seed;
+    int matches;                  // Every byte so far matched the pattern
+    int closed_ok;                // -1 until close() is called
+} PatternSink;
+
+static int pattern_sink_open(void *ctx, long size) {
+    PatternSink *sink = ctx;
+    sink->announced = size;
+    sink->pos = 0;
+    sink->matches = 1;
+    return 0;
+}
+
+static int pattern_sink_write(void *ctx, const void *buf, size_t len) {
+    PatternSink *sink = ctx;
+    for (size_t i = 0; i < len; i++) {
+        if (((const unsigned char*)buf)[i] != (((sink->pos + i) * 7 + sink->seed) & 0xff)) sink->matches = 0;
+    }
+    sink->pos += len;
+    return 0;
+}
+
+static void pattern_sink_close(void *ctx, int ok) {
+    ((PatternSink*)ctx)->closed_ok = ok;
+}
+
+/**
+ * Submit-and-wait helper for requests that are expected to finish
+ */
+static RfsStatus finish(RfsRequest *req) {
+    if (!req) return RFS_ERR_IO;
+    RfsStatus status = rfs_request_wait(req, WAIT_MS);
+    rfs_request_release(req);
+    return status;
+}
+
+/*
+ * Checks
+ */
+
+/**
+ * Buffer and custom sources/sinks across chunk boundaries
+ */
+static void check_round_trips(void) {
+    RfsClient *client = make_client(server.port, 2, WAIT_MS);
+    expect("client created", client != NULL);
+    if (!client) return;
+
+    static const long sizes[] = { 0, 1, BUFFER_SIZE - 1, BUFFER_SIZE, BUFFER_SIZE + 1, 3 * BUFFER_SIZE + 17 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        long size = sizes[i];
+        char path[64], what[96];
+        snprintf(path, sizeof(path), "round/%ld", size);
+
+        // Buffer upload, buffer download
+        char *data = malloc(size + 1);
+        for (long j = 0; j < size; j++) data[j] = (char)(j * 31 + size);
+        snprintf(what, sizeof(what), "write buffer of %ld bytes", size);
+        expect_status(what, finish(rfs_write_buffer(client, data, size, path, NULL, NULL)), RFS_OK);
+
+        RfsRequest *req = rfs_get_buffer(client, path, NULL, NULL);
+        snprintf(what, sizeof(what), "get buffer of %ld bytes", size);
+        expect_status(what, req ? rfs_request_wait(req, WAIT_MS) : RFS_ERR_IO, RFS_OK);
+        size_t len = 0;
+        const char *got = req ? rfs_request_data(req, &len) : NULL;
+        snprintf(what, sizeof(what), "buffer of %ld bytes round-trips", size);
+        expect(what, got && len == (size_t)size && memcmp(got, data, size) == 0);
+        rfs_request_release(req);
+        free(data);
+
+        // Custom source, custom sink
+        PatternSource source = { size, 0, (int)i, -1 };
+        RfsSource source_ops = { pattern_open, pattern_read, pattern_close, &source };
+        snprintf(what, sizeof(what), "write source of %ld bytes", size);
+        expect_status(what, finish(rfs_write_source(client, &source_ops, path, NULL, NULL)), RFS_OK);
+        expect("source closed with ok", source.closed_ok == 1);
+
+        PatternSink sink = { -1, 0, (int)i, 0, -1 };
+        RfsSink sink_ops = { pattern_sink_open, pattern_sink_write, pattern_sink_close, &sink };
+        snprintf(what, sizeof(what), "get sink of %ld bytes", size);
+        expect_status(what, finish(rfs_get_sink(client, path, &sink_ops, NULL, NULL)), RFS_OK);
+        snprintf(what, sizeof(what), "sink of %ld bytes round-trips", size);
+        expect(what, sink.announced == size && sink.pos == size && sink.matches && sink.closed_ok == 1);
+    }
+
+    // A source must be able to report its size
+    RfsSource no_open = { NULL, pattern_read, NULL, NULL };
+    expect("source without open rejected", rfs_write_source(client, &no_open, "round/x", NULL, NULL) == NULL);
+    RfsSink no_write = { NULL, NULL, NULL, NULL };
+    expect("sink without write rejected", rfs_get_sink(client, "round/x", &no_write, NULL, NULL) == NULL);
+
+    expect_status("rm existing file", finish(rfs_rm(client, "round/1", NULL, NULL)), RFS_OK);
+    expect_status("get removed file", finish(rfs_get_buffer(client, "round/1", NULL, NULL)), RFS_ERR_REMOTE);
+    expect_status("rm missing file", finish(rfs_rm(client, "round/1", NULL, NULL)), RFS_ERR_REMOTE);
+
+    rfs_client_destroy(client);
+}
+
+/**
+ * A connection survives requests the server rejects and is replaced when the server drops it
+ */
+static void check_reuse_after_failure(void) {
+    RfsClient *client = make_client(server.port, 1, WAIT_MS);
+    if (!client) return;
+
+    expect_status("write before failures", finish(rfs_write_buffer(client, "hello", 5, "reuse/a", NULL, NULL)), RFS_OK);
+    int accepts = atomic_load(&server.accepts);
+
+    expect_status("get missing file", finish(rfs_get_buffer(client, "reuse/missing", NULL, NULL)), RFS_ERR_REMOTE);
+    expect_status("get after missing file", finish(rfs_get_buffer(client, "reuse/a", NULL, NULL)), RFS_OK);
+    expect_status("get corrupt download", finish(rfs_get_buffer(client, "corrupt/a", NULL, NULL)), RFS_ERR_INTEGRITY);
+    expect_status("get after corrupt download", finish(rfs_get_buffer(client, "reuse/a", NULL, NULL)), RFS_OK);
+    expect("connection kept across rejected requests", atomic_load(&server.accepts) == accepts);
+
+    expect_status("request on dropped connection", finish(rfs_get_buffer(client, "drop/a", NULL, NULL)), RFS_ERR_IO);
+    expect_status("get after dropped connection", finish(rfs_get_buffer(client, "reuse/a", NULL, NULL)), RFS_OK);
+    expect("dropped connection replaced once", atomic_load(&server.accepts) == accepts + 1);
+
+    rfs_client_destroy(client);
+}
+
+/**
+ * Cancellation of a queued request and of a transfer in flight
+ */
+static void check_cancel(void) {
+    RfsClient *client = make_client(server.port, 1, WAIT_MS);
+    if (!client) return;
+    int stalled = server.stalled;
+
+    // The only worker is stuck in a stalled download
+    RfsRequest *in_flight = rfs_get_buffer(client, "stall/a", NULL, NULL);
+    expect("stalled download started", wait_stalled(stalled + 1) == 0);
+
+    // Cancelling a queued request completes it on the spot, on this thread
+    CallbackLog log = { 0 };
+    RfsRequest *queued = rfs_write_buffer(client, "x", 1, "cancel/queued", log_callback, &log);
+    expect("cancel queued request", rfs_request_cancel(queued) == 0);
+    expect_status("queued request status right after cancel", rfs_request_status(queued), RFS_ERR_CANCELED);
+    expect("queued callback ran once on the cancelling thread",
+           atomic_load(&log.calls) == 1 && pthread_equal(log.thread, pthread_self()));
+    expect("cancel completed request", rfs_request_cancel(queued) == -1);
+    rfs_request_release(queued);
+
+    // Cancelling the transfer aborts it well before the client timeout
+    expect("cancel in-flight request", rfs_request_cancel(in_flight) == 0);
+    expect_status("in-flight request after cancel", rfs_request_wait(in_flight, WAIT_MS / 2), RFS_ERR_CANCELED);
+    rfs_request_release(in_flight);
+
+    // The worker reconnects for the next request
+    expect_status("request after cancel", finish(rfs_write_buffer(client, "y", 1, "cancel/after", NULL, NULL)), RFS_OK);
+    rfs_client_destroy(client);
+}
+
+/**
+ * Cancellation while the worker is still connecting
+ */
+static void check_cancel_connecting(int full_port) {
+    RfsClient *client = make_client(full_port, 1, 500);
+    if (!client) return;
+
+    RfsRequest *req = rfs_get_buffer(client, "cancel/connecting", NULL, NULL);
+    usleep(50 * 1000);
+    expect("cancel while connecting", rfs_request_cancel(req) == 0);
+    // Not queued any more, so it completes only when the connect gives up
+    expect_status("connecting request right after cancel", rfs_request_status(req), RFS_PENDING);
+    expect_status("connecting request after cancel", rfs_request_wait(req, WAIT_MS), RFS_ERR_CANCELED);
+    rfs_request_release(req);
+    rfs_client_destroy(client);
+}
+
+/**
+ * Connect and transfer timeouts
+ */
+static void check_timeouts(int full_port) {
+    RfsClient *client = make_client(full_port, 1, SHORT_TIMEOUT_MS);
+    if (client) {
+        expect_status("connect timeout", finish(rfs_get_buffer(client, "timeout/a", NULL, NULL)), RFS_ERR_TIMEOUT);
+        rfs_client_destroy(client);
+    }
+
+    client = make_client(server.port, 1, SHORT_TIMEOUT_MS);
+    if (!client) return;
+    expect_status("transfer timeout", finish(rfs_get_buffer(client, "stall/timeout", NULL, NULL)), RFS_ERR_TIMEOUT);
+    expect_status("request after timeout", finish(rfs_write_buffer(client, "z", 1, "timeout/after", NULL, NULL)), RFS_OK);
+    rfs_client_destroy(client);
+}
+
+/**
+ * Destroying a client fails its queued and in-flight requests; handles stay valid
+ */
+static void check_destroy_with_queue(void) {
+    RfsClient *client = make_client(server.port, 1, WAIT_MS);
+    if (!client) return;
+    int stalled = server.stalled;
+
+    CallbackLog log = { 0 };
+    RfsRequest *reqs[4];
+    reqs[0] = rfs_get_buffer(client, "stall/destroy", log_callback, &log);
+    expect("stalled download started", wait_stalled(stalled + 1) == 0);
+    for (int i = 1; i < 4; i++) {
+        reqs[i] = rfs_write_buffer(client, "q", 1, "destroy/queued", log_callback, &log);
+    }
+
+    rfs_client_destroy(client);
+    expect("every callback ran before destroy returned", atomic_load(&log.calls) == 4);
+    for (int i = 0; i < 4; i++) {
+        expect_status(i == 0 ? "in-flight request after destroy" : "queued request after destroy",
+                      rfs_request_status(reqs[i]), RFS_ERR_CANCELED);
+        rfs_request_release(reqs[i]);
+    }
+}
+
+/**
+ * Run the checks
+ *
+ * @return 0 if every check passed, 1 otherwise
+ */
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.stalled_cond, NULL);
+    server.listen_sock = listen_loopback(16, &server.port);
+    int full_port;
+    if (server.listen_sock < 0 || start_full_listener(&full_port) < 0) {
+        perror("Error opening test listeners");
+        return 1;
+    }
+    pthread_t accept_thread;
+    pthread_create(&accept_thread, NULL, accept_main, NULL);
+
+    check_round_trips();
+    check_reuse_after_failure();
+    check_cancel();
+    check_cancel_connecting(full_port);
+    check_timeouts(full_port);
+    check_destroy_with_queue();
+
+    printf("rfs_lib: %d/%d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,427 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_log.c -- Asynchronous logging and request tracing
+ *
+ * Every thread owns a single-producer/single-consumer ring of fixed-size
+ * slots, claimed the first time the thread logs. The producer formats into
+ * a slot and publishes it by advancing `head`; the drain thread consumes by
+ * advancing `tail`. Rings are never freed: a thread's ring is retired when
+ * the thread exits and returned to the pool once the drain thread has
+ * emptied it, so a thread-per-connection server reuses a few rings instead
+ * of allocating one per connection. The ring list only ever grows at its
+ * head, so claiming a ring and sweeping the list take no lock.
+ *
+ * The drain thread sleeps between sweeps when the rings are empty. A
+ * producer whose ring passes half full wakes it early, so a burst from one
+ * thread is drained long before the ring overflows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include "rfs_log.h"
+
+/* Drain thread, per-thread rings */
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LOG_RING_SLOTS 1024      // Slots per thread ring, a power of two
+#define LOG_RING_PREALLOC 32     // Rings created up front by log_init
+#define LOG_MSG_MAX 104          // Longest message kept, including the NUL
+#define LOG_DRAIN_INTERVAL_MS 5  // Longest idle sleep between drain sweeps
+
+typedef enum {
+    SLOT_MESSAGE,
+    SLOT_TRACE
+} SlotKind;
+
+typedef enum {
+    RING_FREE,      // In the pool, empty
+    RING_OWNED,     // Claimed by a live thread
+    RING_RETIRED    // Owner exited; returns to the pool once drained
+} RingState;
+
+/**
+ * One ring slot: a text message or a trace record
+ */
+typedef struct {
+    uint8_t kind;                 // SlotKind
+    uint8_t level;                // LogLevel of a message
+    int32_t errnum;               // errno to describe after a message, 0 if none
+    union {
+        struct {
+            uint64_t timestamp_ns;    // CLOCK_MONOTONIC
+            uint64_t trace_id;        // Request ID, 0 if none
+            char text[LOG_MSG_MAX];   // Formatted message
+        } message;
+        TraceRecord trace;
+    };
+} LogSlot;
+
+/**
+ * Per-thread ring buffer
+ * head and tail live on separate cache lines so the producer and the
+ * drain thread don't false-share
+ */
+typedef struct LogRing {
+    _Alignas(64) atomic_uint head;   // Next slot to fill (written by the owner)
+    _Alignas(64) atomic_uint tail;   // Next slot to drain (written by the drain thread)
+    atomic_ulong dropped;            // Records lost because the ring was full
+    atomic_int state;                // RingState
+    atomic_uint thread_id;           // Small ID of the owner, shown in the log
+    unsigned long dropped_reported;  // Drops already reported in the log
+    struct LogRing *next;            // Next ring in the list, set before publishing
+    LogSlot slots[LOG_RING_SLOTS];
+} LogRing;
+
+static struct {
+    atomic_int running;           // Records are accepted
+    atomic_int stopping;          // Drain thread should finish up
+    atomic_int tracing;           // Trace records are accepted
+    FILE *log_file;               // Text log
+    FILE *trace_file;             // Binary trace, NULL if disabled
+    uint64_t monotonic_base_ns;   // Clock readings taken together at startup
+    uint64_t realtime_base_ns;
+    pthread_t drain_thread;
+    pthread_mutex_t wake_lock;    // Guards wake_pending for the drain thread's sleep
+    pthread_cond_t wake_cond;
+    int wake_pending;             // A producer asked for a sweep
+    _Atomic(LogRing*) rings;      // All rings, newest first
+    pthread_key_t ring_key;       // Retires a thread's ring when it exits
+    atomic_uint next_thread_id;
+    atomic_ulong next_trace_id;
+} logger;
+
+LogLevel log_level = LOG_LEVEL_INFO;
+
+static __thread LogRing *local_ring;
+
+static const char *level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * ring_retire - Thread-exit destructor: hand the ring over to the drain thread
+ */
+static void ring_retire(void *arg) {
+    LogRing *ring = arg;
+    atomic_store_explicit(&ring->state, RING_RETIRED, memory_order_release);
+}
+
+/**
+ * ring_create - Allocate a ring and add it to the list
+ * @state: Initial RingState
+ *
+ * Returns the ring, or NULL if out of memory
+ */
+static LogRing *ring_create(RingState state) {
+    LogRing *ring;
+    if (posix_memalign((void**)&ring, 64, sizeof(LogRing)) != 0) return NULL;
+    memset(ring, 0, sizeof(LogRing));
+    atomic_init(&ring->state, state);
+
+    // Push onto the list head; rings are never unlinked
+    LogRing *head = atomic_load_explicit(&logger.rings, memory_order_relaxed);
+    do {
+        ring->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&logger.rings, &head, ring,
+                                                    memory_order_release, memory_order_relaxed));
+    return ring;
+}
+
+/**
+ * thread_ring - The calling thread's ring, claiming one on first use
+ *
+ * A free ring from the pool is reused when there is one; a new ring is
+ * only allocated when every ring is in use.
+ * Returns the ring, or NULL if the logger is not running or out of memory
+ */
+static LogRing *thread_ring(void) {
+    if (local_ring) return local_ring;
+    if (!atomic_load_explicit(&logger.running, memory_order_acquire)) return NULL;
+
+    LogRing *ring;
+    for (ring = atomic_load_explicit(&logger.rings, memory_order_acquire); ring; ring = ring->next) {
+        int expected = RING_FREE;
+        if (atomic_load_explicit(&ring->state, memory_order_relaxed) == RING_FREE &&
+            atomic_compare_exchange_strong_explicit(&ring->state, &expected, RING_OWNED,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            break;
+        }
+    }
+    if (!ring) {
+        ring = ring_create(RING_OWNED);
+        if (!ring) return NULL;
+    }
+    atomic_store_explicit(&ring->thread_id, atomic_fetch_add(&logger.next_thread_id, 1) + 1,
+                          memory_order_relaxed);
+
+    pthread_setspecific(logger.ring_key, ring);
+    local_ring = ring;
+    return ring;
+}
+
+/**
+ * ring_reserve - Claim the next free slot of the calling thread's ring
+ *
+ * Returns the slot, to be published with ring_publish, or NULL if the
+ * record must be dropped
+ */
+static LogSlot *ring_reserve(LogRing **ring_out) {
+    LogRing *ring = thread_ring();
+    if (!ring) return NULL;
+
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= LOG_RING_SLOTS) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+    *ring_out = ring;
+    return &ring->slots[head & (LOG_RING_SLOTS - 1)];
+}
+
+/**
+ * drain_wake - Cut the drain thread's idle sleep short
+ */
+static void drain_wake(void) {
+    pthread_mutex_lock(&logger.wake_lock);
+    logger.wake_pending = 1;
+    pthread_cond_signal(&logger.wake_cond);
+    pthread_mutex_unlock(&logger.wake_lock);
+}
+
+static void ring_publish(LogRing *ring) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    // Wake the drain thread once as the ring crosses half full, rather
+    // than leaving the rest of a burst to fit in before the next sweep
+    if (head + 1 - tail == LOG_RING_SLOTS / 2) {
+        drain_wake();
+    }
+}
+
+void log_write(LogLevel level, uint64_t trace_id, int errnum, const char *fmt, ...) {
+    LogRing *ring;
+    LogSlot *slot = ring_reserve(&ring);
+    if (!slot) return;
+
+    slot->kind = SLOT_MESSAGE;
+    slot->level = level;
+    slot->errnum = errnum;
+    slot->message.timestamp_ns = clock_ns(CLOCK_MONOTONIC);
+    slot->message.trace_id = trace_id;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(slot->message.text, sizeof(slot->message.text), fmt, args);
+    va_end(args);
+
+    ring_publish(ring);
+}
+
+void trace_event(TraceEvent event, uint64_t trace_id, uint32_t conn_id, int op, uint64_t value, int status) {
+    if (!atomic_load_explicit(&logger.tracing, memory_order_relaxed)) return;
+
+    LogRing *ring;
+    LogSlot *slot = ring_reserve(&ring);
+    if (!slot) return;
+
+    slot->kind = SLOT_TRACE;
+    slot->trace.timestamp_ns = clock_ns(CLOCK_MONOTONIC);
+    slot->trace.trace_id = trace_id;
+    slot->trace.value = value;
+    slot->trace.conn_id = conn_id;
+    slot->trace.event = event;
+    slot->trace.op = op;
+    slot->trace.status = status;
+
+    ring_publish(ring);
+}
+
+uint64_t trace_next_id(void) {
+    return atomic_fetch_add(&logger.next_trace_id, 1) + 1;
+}
+
+/**
+ * write_message - Format a drained message as one line of the text log
+ */
+static void write_message(unsigned int thread_id, const LogSlot *slot) {
+    // Convert the monotonic timestamp to wall-clock time
+    uint64_t wall_ns = logger.realtime_base_ns + (slot->message.timestamp_ns - logger.monotonic_base_ns);
+    time_t seconds = wall_ns / 1000000000;
+    struct tm tm;
+    char when[32];
+    localtime_r(&seconds, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+
+    fprintf(logger.log_file, "%s.%06u %-5s [t%u", when, (unsigned)(wall_ns % 1000000000 / 1000),
+            level_names[slot->level], thread_id);
+    if (slot->message.trace_id) {
+        fprintf(logger.log_file, " r%llu", (unsigned long long)slot->message.trace_id);
+    }
+    fprintf(logger.log_file, "] %s", slot->message.text);
+    if (slot->errnum) {
+        // Only the drain thread calls strerror, so its static buffer is safe here
+        fprintf(logger.log_file, ": %s", strerror(slot->errnum));
+    }
+    fputc('\n', logger.log_file);
+}
+
+/**
+ * drain_rings - Write out everything currently in the rings
+ *
+ * Takes no lock, so producers never wait on log file I/O.
+ * Returns the number of records drained
+ */
+static unsigned long drain_rings(void) {
+    unsigned long drained = 0;
+
+    LogRing *ring = atomic_load_explicit(&logger.rings, memory_order_acquire);
+    for (; ring; ring = ring->next) {
+        // Read the state before head so a retired ring is seen fully published
+        int state = atomic_load_explicit(&ring->state, memory_order_acquire);
+        if (state == RING_FREE) continue;
+        unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        unsigned int thread_id = atomic_load_explicit(&ring->thread_id, memory_order_relaxed);
+
+        for (; tail != head; tail++) {
+            const LogSlot *slot = &ring->slots[tail & (LOG_RING_SLOTS - 1)];
+            if (slot->kind == SLOT_TRACE) {
+                if (logger.trace_file) fwrite(&slot->trace, sizeof(TraceRecord), 1, logger.trace_file);
+            } else {
+                write_message(thread_id, slot);
+            }
+            drained++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+        unsigned long dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        if (dropped != ring->dropped_reported) {
+            fprintf(logger.log_file, "[t%u] ring full, dropped %lu records\n",
+                    thread_id, dropped - ring->dropped_reported);
+            ring->dropped_reported = dropped;
+        }
+
+        // The owner has exited and everything it wrote is out: back to the pool
+        if (state == RING_RETIRED) {
+            atomic_store_explicit(&ring->state, RING_FREE, memory_order_release);
+        }
+    }
+
+    if (drained) {
+        fflush(logger.log_file);
+        if (logger.trace_file) fflush(logger.trace_file);
+    }
+    return drained;
+}
+
+/**
+ * drain_main - Drain thread: sweep the rings until shutdown
+ *
+ * Sleeps up to LOG_DRAIN_INTERVAL_MS after a sweep that found nothing, or
+ * until a producer or log_shutdown wakes it.
+ */
+static void *drain_main(void *args) {
+    while (!atomic_load(&logger.stopping)) {
+        if (drain_rings() != 0) continue;
+
+        uint64_t deadline_ns = clock_ns(CLOCK_MONOTONIC) + LOG_DRAIN_INTERVAL_MS * 1000000ULL;
+        struct timespec deadline = { deadline_ns / 1000000000, deadline_ns % 1000000000 };
+        pthread_mutex_lock(&logger.wake_lock);
+        while (!logger.wake_pending && !atomic_load(&logger.stopping)) {
+            if (pthread_cond_timedwait(&logger.wake_cond, &logger.wake_lock, &deadline) != 0) break;
+        }
+        logger.wake_pending = 0;
+        pthread_mutex_unlock(&logger.wake_lock);
+    }
+    drain_rings();
+    return NULL;
+}
+
+int log_init(const char *log_path, const char *trace_path, LogLevel level) {
+    log_level = level;
+    logger.monotonic_base_ns = clock_ns(CLOCK_MONOTONIC);
+    logger.realtime_base_ns = clock_ns(CLOCK_REALTIME);
+
+    logger.log_file = strcmp(log_path, "-") == 0 ? stderr : fopen(log_path, "a");
+    if (!logger.log_file) {
+        return -1;
+    }
+
+    if (trace_path) {
+        logger.trace_file = fopen(trace_path, "wb");
+        if (!logger.trace_file) {
+            if (logger.log_file != stderr) fclose(logger.log_file);
+            return -1;
+        }
+        TraceHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+        header.version = TRACE_VERSION;
+        header.record_size = sizeof(TraceRecord);
+        header.monotonic_base_ns = logger.monotonic_base_ns;
+        header.realtime_base_ns = logger.realtime_base_ns;
+        fwrite(&header, sizeof(header), 1, logger.trace_file);
+        atomic_store(&logger.tracing, 1);
+    }
+
+    // Stock the pool so the first connections don't allocate
+    for (int i = 0; i < LOG_RING_PREALLOC; i++) {
+        ring_create(RING_FREE);
+    }
+
+    // The drain thread's idle sleep is timed on the monotonic clock
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&logger.wake_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    pthread_mutex_init(&logger.wake_lock, NULL);
+
+    pthread_key_create(&logger.ring_key, ring_retire);
+    atomic_store(&logger.running, 1);
+    if (pthread_create(&logger.drain_thread, NULL, drain_main, NULL) != 0) {
+        atomic_store(&logger.running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (!atomic_load(&logger.running)) return;
+
+    // Stop accepting records, then let the drain thread empty the rings
+    atomic_store(&logger.running, 0);
+    atomic_store(&logger.tracing, 0);
+    atomic_store(&logger.stopping, 1);
+    drain_wake();
+    pthread_join(logger.drain_thread, NULL);
+
+    if (logger.log_file != stderr) fclose(logger.log_file);
+    if (logger.trace_file) fclose(logger.trace_file);
+    logger.log_file = NULL;
+    logger.trace_file = NULL;
+}
+
+int log_parse_level(const char *name, LogLevel *level) {
+    static const char *names[] = { "debug", "info", "warn", "error" };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *level = (LogLevel)i;
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,142 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_log.h - Asynchronous logging and request tracing for the RFS server
+ *
+ * Each thread appends fixed-size records to its own lock-free ring buffer;
+ * a background thread drains all rings to a text log and, optionally, a
+ * binary trace file. Rings come from a pool that is reused as threads come
+ * and go; producers only allocate when every ring is in use, and only take
+ * a lock to wake the drain thread when their ring passes half full. They
+ * drop records (counting them) rather than block when their ring is full.
+ */
+
+#ifndef RFS_LOG_H
+#define RFS_LOG_H
+
+#include <stdint.h>
+
+/**
+ * Log levels, in increasing severity
+ */
+typedef enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+} LogLevel;
+
+/**
+ * Trace events recorded for each request
+ */
+typedef enum {
+    TRACE_ACCEPT = 1,   // Connection accepted (trace_id 0, value = client IPv4 address)
+    TRACE_REQUEST,      // Command received, request starts
+    TRACE_LOCK_ACQUIRE, // First I/O scheduler grant for the request
+    TRACE_FIRST_BYTE,   // First payload byte moved
+    TRACE_COMPLETE      // Request finished (value = payload bytes, status = result)
+} TraceEvent;
+
+#define TRACE_MAGIC "RFSTRACE"
+#define TRACE_VERSION 1
+
+/**
+ * Header at the start of a binary trace file
+ * The two clock readings were taken together and convert record
+ * timestamps to wall-clock time.
+ */
+typedef struct {
+    char magic[8];                // TRACE_MAGIC
+    uint32_t version;             // TRACE_VERSION
+    uint32_t record_size;         // sizeof(TraceRecord)
+    uint64_t monotonic_base_ns;   // CLOCK_MONOTONIC at startup
+    uint64_t realtime_base_ns;    // CLOCK_REALTIME at startup
+} TraceHeader;
+
+/**
+ * One binary trace record
+ */
+typedef struct {
+    uint64_t timestamp_ns;        // CLOCK_MONOTONIC
+    uint64_t trace_id;            // Request ID, 0 for connection events
+    uint64_t value;               // Event-specific value
+    uint32_t conn_id;             // Connection ID
+    uint8_t event;                // TraceEvent
+    uint8_t op;                   // CommandType of the request
+    int16_t status;               // TRACE_COMPLETE: request status
+} TraceRecord;
+
+// Minimum level that is recorded; checked inline so filtered calls are free
+extern LogLevel log_level;
+
+/**
+ * Log a formatted message
+ * @param level Severity
+ * @param trace_id Request the message belongs to, 0 if none
+ */
+#define log_msg(level, trace_id, ...) \
+    do { if ((level) >= log_level) log_write((level), (trace_id), 0, __VA_ARGS__); } while (0)
+
+/**
+ * Log a formatted message followed by the description of an errno value
+ * The description is looked up by the drain thread, off the hot path
+ * @param level Severity
+ * @param trace_id Request the message belongs to, 0 if none
+ * @param errnum errno value to describe
+ */
+#define log_errno(level, trace_id, errnum, ...) \
+    do { if ((level) >= log_level) log_write((level), (trace_id), (errnum), __VA_ARGS__); } while (0)
+
+/**
+ * Start the logger and its drain thread
+ * @param log_path Text log file, "-" for stderr
+ * @param trace_path Binary trace file, NULL to disable tracing
+ * @param level Minimum level to record
+ * @return 0 on success, -1 on error
+ */
+int log_init(const char *log_path, const char *trace_path, LogLevel level);
+
+/**
+ * Drain all pending records, stop the drain thread and close the files
+ */
+void log_shutdown(void);
+
+/**
+ * Append a message record to the calling thread's ring (use log_msg)
+ * @param level Severity
+ * @param trace_id Request ID, 0 if none
+ * @param errnum errno value to describe, 0 if none
+ * @param fmt printf-style format
+ */
+void log_write(LogLevel level, uint64_t trace_id, int errnum, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/**
+ * Append a trace record to the calling thread's ring
+ * Does nothing when tracing is disabled
+ * @param event TraceEvent
+ * @param trace_id Request ID, 0 for connection events
+ * @param conn_id Connection ID
+ * @param op CommandType of the request
+ * @param value Event-specific value
+ * @param status Request status for TRACE_COMPLETE
+ */
+void trace_event(TraceEvent event, uint64_t trace_id, uint32_t conn_id, int op, uint64_t value, int status);
+
+/**
+ * Allocate a new request trace ID
+ * @return Unique non-zero ID
+ */
+uint64_t trace_next_id(void);
+
+/**
+ * Parse a level name (debug, info, warn, error)
+ * @param name Level name
+ * @param level Set to the parsed level
+ * @return 0 on success, -1 on unknown name
+ */
+int log_parse_level(const char *name, LogLevel *level);
+
+#endif // RFS_LOG_H
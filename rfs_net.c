@@ -0,0 +1,98 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_net.c -- Protocol helpers shared by the client library and the server
+ *
+ * A single send()/recv() may transfer fewer bytes than requested, which
+ * desynchronizes the stream once several commands share one connection.
+ * These helpers loop until the whole buffer has been moved. The digest
+ * helpers build the whole-file CRC32C that ends every payload.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include "rfs.h"
+#include "rfs_crc32c.h"
+
+/**
+ * rfs_send_all - Send an entire buffer over a socket
+ * @socket: Connected socket descriptor
+ * @buf: Data to send
+ * @len: Number of bytes to send
+ *
+ * Retries on short writes and EINTR. SIGPIPE is suppressed where the
+ * platform allows it so a vanished peer surfaces as an error, not a signal.
+ * Returns 0 on success, -1 on error (errno is preserved)
+ */
+int rfs_send_all(int socket, const void *buf, size_t len) {
+    const char *p = buf;
+    int flags = 0;
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+
+    while (len > 0) {
+        ssize_t sent = send(socket, p, len, flags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += sent;
+        len -= sent;
+    }
+    return 0;
+}
+
+/**
+ * rfs_recv_all - Receive exactly @len bytes from a socket
+ * @socket: Connected socket descriptor
+ * @buf: Destination buffer
+ * @len: Number of bytes to receive
+ *
+ * Retries on short reads and EINTR.
+ * Returns @len on success, the number of bytes read before the peer closed
+ * the connection (0 for a clean close between messages), or -1 on error
+ */
+ssize_t rfs_recv_all(int socket, void *buf, size_t len) {
+    char *p = buf;
+    size_t total = 0;
+
+    while (total < len) {
+        ssize_t received = recv(socket, p + total, len - total, 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (received == 0) break;
+        total += received;
+    }
+    return total;
+}
+
+/**
+ * rfs_digest_init - Start a whole-file digest
+ * @digest: Digest to initialize
+ */
+void rfs_digest_init(PayloadDigest *digest) {
+    digest->file_crc = 0;
+    digest->chunk_op = rfs_crc32c_combine_gen(BUFFER_SIZE);
+}
+
+/**
+ * rfs_digest_add - Append a chunk to a whole-file digest
+ * @digest: Digest to extend
+ * @chunk_crc: CRC32C of the chunk
+ * @len: Chunk length in bytes
+ */
+void rfs_digest_add(PayloadDigest *digest, uint32_t chunk_crc, size_t len) {
+    if (len == BUFFER_SIZE) {
+        digest->file_crc = rfs_crc32c_combine_op(digest->file_crc, chunk_crc, digest->chunk_op);
+    } else {
+        digest->file_crc = rfs_crc32c_combine(digest->file_crc, chunk_crc, len);
+    }
+}
@@ -0,0 +1,341 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_sched.c -- Fair-share I/O scheduler for the RFS server
+ *
+ * One mutex guards all scheduler state. A thread asking for a slice
+ * queues its flow on its class list and sleeps on the flow's condition
+ * variable; whichever thread frees a slot (or finds one free) picks the
+ * next flow and signals it. Rate-limited flows are skipped and the
+ * earliest time one of them becomes eligible is published in wake_at so
+ * the flow due first re-runs the dispatcher when credit is available.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "rfs.h"
+#include "rfs_sched.h"
+
+/* Scheduler state is shared by all connection threads */
+#include <pthread.h>
+
+/**
+ * Token bucket for a bandwidth cap
+ * Tokens may go negative by up to one slice; the debt is repaid before
+ * the owner is eligible again.
+ */
+typedef struct {
+    long rate;                    // Bytes per second, 0 = unlimited
+    double burst;                 // Maximum stored tokens
+    double tokens;                // Available bytes
+    double last;                  // Time of the last refill
+} TokenBucket;
+
+/**
+ * Per-client-address state shared by that client's connections
+ */
+typedef struct SchedClient {
+    struct in_addr addr;          // Client address
+    int refs;                     // Open flows for this address
+    TokenBucket bucket;           // Per-client bandwidth cap
+    struct SchedClient *next;     // Next client in the table
+} SchedClient;
+
+struct SchedFlow {
+    SchedClient *client;          // Client this connection belongs to
+    CommandType op;               // Operation of the current transfer
+    SchedClass cls;               // Class of the current transfer
+    long deficit;                 // DRR credit in bytes
+    long want;                    // Size of the pending slice request
+    long granted;                 // Size of the current grant, 0 if none
+    pthread_cond_t cond;          // Signalled when a grant is made
+    SchedFlow *next;              // Next flow in the class queue
+};
+
+static struct {
+    SchedConfig config;
+    pthread_mutex_t lock;
+    SchedFlow *head[SCHED_CLASSES];  // Waiting flows per class
+    SchedFlow *tail[SCHED_CLASSES];
+    int busy;                     // Slices in progress
+    int interactive_streak;       // Interactive grants since bulk was last served
+    TokenBucket op_bucket[CMD_INVALID];
+    SchedClient *clients;         // Clients with open flows
+    double wake_at;               // When a rate-limited flow becomes eligible, 0 if none
+    SchedFlow *wake_flow;         // The flow that becomes eligible at wake_at
+} sched;
+
+/**
+ * Monotonic time in seconds
+ */
+static double sched_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bucket_init(TokenBucket *bucket, long rate) {
+    bucket->rate = rate;
+    // Allow a second's worth of burst, but never less than one round
+    bucket->burst = rate > sched.config.quantum ? rate : sched.config.quantum;
+    bucket->tokens = bucket->burst;
+    bucket->last = sched_now();
+}
+
+/**
+ * bucket_ready_at - Refill a bucket and report when it can be drawn from
+ *
+ * Returns @now if the bucket has credit, otherwise the time its debt is repaid
+ */
+static double bucket_ready_at(TokenBucket *bucket, double now) {
+    if (bucket->rate == 0) return now;
+
+    bucket->tokens += (now - bucket->last) * bucket->rate;
+    if (bucket->tokens > bucket->burst) bucket->tokens = bucket->burst;
+    bucket->last = now;
+
+    if (bucket->tokens > 0) return now;
+    return now + (1 - bucket->tokens) / bucket->rate;
+}
+
+static void bucket_charge(TokenBucket *bucket, long bytes) {
+    if (bucket->rate != 0) bucket->tokens -= bytes;
+}
+
+/**
+ * flow_ready_at - Earliest time a flow's rate limits allow a grant
+ */
+static double flow_ready_at(SchedFlow *flow, double now) {
+    double client_ready = bucket_ready_at(&flow->client->bucket, now);
+    double op_ready = bucket_ready_at(&sched.op_bucket[flow->op], now);
+    return client_ready > op_ready ? client_ready : op_ready;
+}
+
+/**
+ * sched_pick - Remove and return the next flow to serve, or NULL
+ * @now: Current time
+ *
+ * Interactive flows go first, except that a waiting bulk flow is served
+ * after SCHED_BULK_EVERY consecutive interactive grants so it can't starve.
+ * Within a class the first eligible flow in queue order wins; the queue
+ * order itself implements the round-robin.
+ */
+static SchedFlow *sched_pick(double now) {
+    SchedClass order[SCHED_CLASSES] = { SCHED_INTERACTIVE, SCHED_BULK };
+    if (sched.interactive_streak >= SCHED_BULK_EVERY) {
+        order[0] = SCHED_BULK;
+        order[1] = SCHED_INTERACTIVE;
+    }
+
+    for (int i = 0; i < SCHED_CLASSES; i++) {
+        SchedClass cls = order[i];
+        SchedFlow *prev = NULL;
+        for (SchedFlow *flow = sched.head[cls]; flow; prev = flow, flow = flow->next) {
+            double ready = flow_ready_at(flow, now);
+            if (ready > now) {
+                if (sched.wake_at == 0 || ready < sched.wake_at) {
+                    sched.wake_at = ready;
+                    sched.wake_flow = flow;
+                }
+                continue;
+            }
+
+            // Unlink from the class queue
+            if (prev) prev->next = flow->next;
+            else sched.head[cls] = flow->next;
+            if (sched.tail[cls] == flow) sched.tail[cls] = prev;
+            flow->next = NULL;
+
+            if (cls == SCHED_INTERACTIVE && sched.head[SCHED_BULK]) {
+                sched.interactive_streak++;
+            } else {
+                sched.interactive_streak = 0;
+            }
+            return flow;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * sched_dispatch - Hand free slots to waiting flows
+ *
+ * Must be called with sched.lock held
+ */
+static void sched_dispatch(void) {
+    double now = sched_now();
+    sched.wake_at = 0;
+    sched.wake_flow = NULL;
+
+    while (sched.busy < sched.config.slots) {
+        SchedFlow *flow = sched_pick(now);
+        if (!flow) break;
+
+        flow->granted = flow->want;
+        flow->deficit -= flow->want;
+        bucket_charge(&flow->client->bucket, flow->want);
+        bucket_charge(&sched.op_bucket[flow->op], flow->want);
+        sched.busy++;
+        pthread_cond_signal(&flow->cond);
+    }
+
+    // Make sure the next flow due for credit sleeps with a timeout,
+    // even if it went to sleep before it was rate limited
+    if (sched.wake_flow) {
+        pthread_cond_signal(&sched.wake_flow->cond);
+    }
+}
+
+void sched_config_init(SchedConfig *config) {
+    memset(config, 0, sizeof(SchedConfig));
+    config->quantum = SCHED_DEFAULT_QUANTUM;
+    config->slots = SCHED_DEFAULT_SLOTS;
+    config->small_size = SCHED_DEFAULT_SMALL;
+}
+
+void sched_init(const SchedConfig *config) {
+    memset(&sched, 0, sizeof(sched));
+    sched.config = *config;
+
+    // A slice is at most BUFFER_SIZE, so a round must cover at least one
+    if (sched.config.quantum < BUFFER_SIZE) sched.config.quantum = BUFFER_SIZE;
+    if (sched.config.slots < 1) sched.config.slots = 1;
+
+    pthread_mutex_init(&sched.lock, NULL);
+    for (int op = 0; op < CMD_INVALID; op++) {
+        bucket_init(&sched.op_bucket[op], sched.config.op_rate[op]);
+    }
+}
+
+SchedFlow *sched_flow_open(struct in_addr client) {
+    SchedFlow *flow = calloc(1, sizeof(SchedFlow));
+    if (!flow) return NULL;
+    pthread_cond_init(&flow->cond, NULL);
+
+    pthread_mutex_lock(&sched.lock);
+
+    // Connections from the same address share one client bucket
+    SchedClient *entry = sched.clients;
+    while (entry && entry->addr.s_addr != client.s_addr) {
+        entry = entry->next;
+    }
+    if (!entry) {
+        entry = calloc(1, sizeof(SchedClient));
+        if (!entry) {
+            pthread_mutex_unlock(&sched.lock);
+            pthread_cond_destroy(&flow->cond);
+            free(flow);
+            return NULL;
+        }
+        entry->addr = client;
+        bucket_init(&entry->bucket, sched.config.client_rate);
+        entry->next = sched.clients;
+        sched.clients = entry;
+    }
+    entry->refs++;
+    flow->client = entry;
+
+    pthread_mutex_unlock(&sched.lock);
+    return flow;
+}
+
+void sched_flow_close(SchedFlow *flow) {
+    if (!flow) return;
+
+    pthread_mutex_lock(&sched.lock);
+    SchedClient *entry = flow->client;
+    if (--entry->refs == 0) {
+        SchedClient **link = &sched.clients;
+        while (*link != entry) {
+            link = &(*link)->next;
+        }
+        *link = entry->next;
+        free(entry);
+    }
+    pthread_mutex_unlock(&sched.lock);
+
+    pthread_cond_destroy(&flow->cond);
+    free(flow);
+}
+
+void sched_begin(SchedFlow *flow, CommandType op, long size) {
+    pthread_mutex_lock(&sched.lock);
+    flow->op = op;
+    flow->cls = size <= sched.config.small_size ? SCHED_INTERACTIVE : SCHED_BULK;
+    flow->deficit = 0;
+    pthread_mutex_unlock(&sched.lock);
+}
+
+long sched_acquire(SchedFlow *flow, long want) {
+    if (want > BUFFER_SIZE) want = BUFFER_SIZE;
+    if (want < 1) want = 1;
+
+    pthread_mutex_lock(&sched.lock);
+    flow->want = want;
+    flow->granted = 0;
+
+    // DRR: a flow whose credit still covers the slice continues its turn
+    // at the head; otherwise it gets a new quantum and waits for the next round
+    SchedClass cls = flow->cls;
+    if (flow->deficit >= want) {
+        flow->next = sched.head[cls];
+        sched.head[cls] = flow;
+        if (!sched.tail[cls]) sched.tail[cls] = flow;
+    } else {
+        flow->deficit += sched.config.quantum;
+        flow->next = NULL;
+        if (sched.tail[cls]) sched.tail[cls]->next = flow;
+        else sched.head[cls] = flow;
+        sched.tail[cls] = flow;
+    }
+
+    sched_dispatch();
+    while (flow->granted == 0) {
+        if (sched.wake_at > 0) {
+            // Sleep until rate-limit credit is due, then dispatch again
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            double delay = sched.wake_at - sched_now();
+            if (delay > 0) {
+                long nsec = deadline.tv_nsec + (long)((delay - (long)delay) * 1e9);
+                deadline.tv_sec += (long)delay + nsec / 1000000000;
+                deadline.tv_nsec = nsec % 1000000000;
+                pthread_cond_timedwait(&flow->cond, &sched.lock, &deadline);
+            }
+        } else {
+            pthread_cond_wait(&flow->cond, &sched.lock);
+        }
+        if (flow->granted == 0) sched_dispatch();
+    }
+    long granted = flow->granted;
+    pthread_mutex_unlock(&sched.lock);
+
+    return granted;
+}
+
+void sched_release(SchedFlow *flow, long used) {
+    pthread_mutex_lock(&sched.lock);
+
+    // Refund what the slice didn't use
+    long unused = flow->granted - used;
+    if (unused > 0) {
+        flow->deficit += unused;
+        bucket_charge(&flow->client->bucket, -unused);
+        bucket_charge(&sched.op_bucket[flow->op], -unused);
+    }
+    flow->granted = 0;
+    sched.busy--;
+
+    sched_dispatch();
+    pthread_mutex_unlock(&sched.lock);
+}
+
+void sched_end(SchedFlow *flow) {
+    pthread_mutex_lock(&sched.lock);
+    // An idle flow forfeits its credit, as in DRR when a queue empties
+    flow->deficit = 0;
+    pthread_mutex_unlock(&sched.lock);
+}
@@ -0,0 +1,110 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_sched.h - Fair-share I/O scheduler for the RFS server
+ *
+ * Transfers are cut into slices of at most BUFFER_SIZE bytes and every
+ * slice needs a grant from the scheduler. At most `slots` slices run at
+ * once. A grant covers the disk side of a slice; socket I/O happens
+ * outside it so a peer that stops sending or reading can't hold a slot.
+ * Waiting connections are served by deficit round-robin, so each
+ * backlogged connection moves about `quantum` bytes per round, and small
+ * transfers (interactive class) are served ahead of bulk ones. Per-client
+ * and per-operation token buckets cap bandwidth.
+ */
+
+#ifndef RFS_SCHED_H
+#define RFS_SCHED_H
+
+#include <netinet/in.h>
+#include "rfs.h"
+
+// Scheduler defaults
+#define SCHED_DEFAULT_QUANTUM (8 * BUFFER_SIZE)  // Bytes per connection per round
+#define SCHED_DEFAULT_SLOTS 4                    // Slices in progress at once
+#define SCHED_DEFAULT_SMALL (64 * 1024)          // Largest interactive transfer
+#define SCHED_BULK_EVERY 8   // Bulk gets a slice after this many interactive ones
+
+/**
+ * Priority classes, served in this order
+ */
+typedef enum {
+    SCHED_INTERACTIVE,   // Transfers up to small_size bytes
+    SCHED_BULK,          // Everything larger
+    SCHED_CLASSES
+} SchedClass;
+
+/**
+ * Scheduler configuration
+ * Rates are in bytes per second; 0 means unlimited
+ */
+typedef struct {
+    long quantum;                  // Bytes credited to a connection per round
+    int slots;                     // Maximum concurrent slices
+    long small_size;               // Transfers up to this size are interactive
+    long client_rate;              // Bandwidth cap per client address
+    long op_rate[CMD_INVALID];     // Bandwidth cap per operation, all clients combined
+} SchedConfig;
+
+/**
+ * Per-connection scheduling state
+ */
+typedef struct SchedFlow SchedFlow;
+
+/**
+ * Fill a configuration with defaults (no rate limits)
+ * @param config Configuration to initialize
+ */
+void sched_config_init(SchedConfig *config);
+
+/**
+ * Initialize the scheduler; must be called once before any other function
+ * @param config Scheduler configuration
+ */
+void sched_init(const SchedConfig *config);
+
+/**
+ * Register a client connection
+ * @param client Client IPv4 address, used for the per-client rate limit
+ * @return Flow for the connection, or NULL on allocation failure
+ */
+SchedFlow *sched_flow_open(struct in_addr client);
+
+/**
+ * Unregister a client connection
+ * @param flow Flow returned by sched_flow_open, may be NULL
+ */
+void sched_flow_close(SchedFlow *flow);
+
+/**
+ * Start a transfer on a flow, choosing its priority class
+ * @param flow Connection flow
+ * @param op Operation type
+ * @param size Total transfer size in bytes
+ */
+void sched_begin(SchedFlow *flow, CommandType op, long size);
+
+/**
+ * Wait for permission to transfer the next slice
+ * @param flow Connection flow with a transfer in progress
+ * @param want Bytes the caller would like to move
+ * @return Granted bytes, between 1 and want
+ */
+long sched_acquire(SchedFlow *flow, long want);
+
+/**
+ * Finish a slice and return unused credit
+ * @param flow Connection flow holding a grant
+ * @param used Bytes actually moved, at most the granted amount
+ */
+void sched_release(SchedFlow *flow, long used);
+
+/**
+ * End the transfer started by sched_begin
+ * @param flow Connection flow
+ */
+void sched_end(SchedFlow *flow);
+
+#endif // RFS_SCHED_H
@@ -0,0 +1,346 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_sched_test.c -- Grant order and rate-limit checks for rfs_sched
+ *
+ * Each flow runs on its own thread, acquiring and releasing slices the
+ * way a connection thread does. With a single slot the grant order only
+ * depends on who is waiting when the slot frees, so the ordering checks
+ * step the flows: the flow holding the slot releases it only once every
+ * other flow with work left is queued. That makes the order exact. The
+ * test includes rfs_sched.c to look at the class queues while stepping.
+ * The rate checks let the flows run freely and compare the bytes granted
+ * against the token buckets.
+ */
+
+#include "rfs_sched.c"
+
+#define MAX_FLOWS 8
+#define MAX_GRANTS 256
+
+static int failures = 0;
+static int checks = 0;
+
+/**
+ * Record one check, reporting it if it failed
+ */
+static void expect(const char *what, int ok) {
+    checks++;
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "FAIL %s\n", what);
+    }
+}
+
+/**
+ * One connection's transfer, driven by its own thread
+ */
+typedef struct {
+    char name;                    // Shown in grant sequences
+    struct in_addr addr;          // Client address
+    CommandType op;               // Operation
+    long size;                    // Transfer size, sets the class
+    long slice;                   // Bytes asked for per acquire
+    long remaining;               // Bytes not yet granted (guarded by test.lock)
+    double finished;              // When the last slice was released
+    SchedFlow *flow;
+    pthread_t thread;
+} TestFlow;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stepped;                  // Grants are held until the driver lets them go
+    TestFlow *holder;             // Flow holding a stepped grant, NULL if none
+    char order[MAX_GRANTS + 1];   // Flow names in grant order
+    long granted[MAX_GRANTS];     // Bytes of each grant
+    int grants;
+} test = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+static void *flow_main(void *arg) {
+    TestFlow *t = arg;
+    sched_begin(t->flow, t->op, t->size);
+
+    long remaining = t->size;
+    while (remaining > 0) {
+        long granted = sched_acquire(t->flow, remaining < t->slice ? remaining : t->slice);
+        remaining -= granted;
+
+        pthread_mutex_lock(&test.lock);
+        t->remaining = remaining;
+        if (test.grants < MAX_GRANTS) {
+            test.granted[test.grants] = granted;
+            test.order[test.grants++] = t->name;
+        }
+        if (test.stepped) {
+            test.holder = t;
+            pthread_cond_broadcast(&test.cond);
+            while (test.holder == t) {
+                pthread_cond_wait(&test.cond, &test.lock);
+            }
+        }
+        pthread_mutex_unlock(&test.lock);
+
+        sched_release(t->flow, granted);
+    }
+
+    sched_end(t->flow);
+    t->finished = sched_now();
+    return NULL;
+}
+
+/**
+ * Number of flows waiting in the scheduler's class queues
+ */
+static int queued_flows(void) {
+    int count = 0;
+    pthread_mutex_lock(&sched.lock);
+    for (int cls = 0; cls < SCHED_CLASSES; cls++) {
+        for (SchedFlow *flow = sched.head[cls]; flow; flow = flow->next) {
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&sched.lock);
+    return count;
+}
+
+static void wait_queued(int count) {
+    while (queued_flows() < count) {
+        usleep(100);
+    }
+}
+
+static void start_flow(TestFlow *t, char name, const char *addr, CommandType op, long size, long slice) {
+    t->name = name;
+    inet_pton(AF_INET, addr, &t->addr);
+    t->op = op;
+    t->size = size;
+    t->slice = slice;
+    t->remaining = size;
+    t->flow = sched_flow_open(t->addr);
+    pthread_create(&t->thread, NULL, flow_main, t);
+}
+
+static void reset(const SchedConfig *config, int stepped) {
+    // Every flow of the previous run is closed, so the scheduler can start afresh
+    sched_init(config);
+    test.stepped = stepped;
+    test.holder = NULL;
+    test.grants = 0;
+    memset(test.order, 0, sizeof(test.order));
+}
+
+static void join_flows(TestFlow *flows, int count) {
+    for (int i = 0; i < count; i++) {
+        pthread_join(flows[i].thread, NULL);
+        sched_flow_close(flows[i].flow);
+    }
+}
+
+/**
+ * Flow of a stepped run
+ */
+typedef struct {
+    char name;                    // Shown in grant sequences
+    long size;                    // Transfer size
+    long slice;                   // Bytes asked for per acquire
+} FlowSpec;
+
+/**
+ * Run flows one grant at a time and return their grant order
+ *
+ * A gate flow takes the only slot first, so the flows queue in the order
+ * given before any of them is served. After that each grant is released
+ * only once every other flow with work left is waiting again.
+ *
+ * @param config Scheduler configuration, slots is forced to 1
+ * @param specs Flows, queued in this order
+ * @param count Number of flows
+ * @return The grant order as a string of flow names
+ */
+static const char *stepped_order(SchedConfig config, const FlowSpec *specs, int count) {
+    static TestFlow flows[MAX_FLOWS];
+    config.slots = 1;
+    reset(&config, 1);
+
+    struct in_addr gate_addr = { htonl(INADDR_LOOPBACK) };
+    SchedFlow *gate = sched_flow_open(gate_addr);
+    sched_begin(gate, CMD_GET, 1);
+    sched_acquire(gate, 1);
+
+    for (int i = 0; i < count; i++) {
+        start_flow(&flows[i], specs[i].name, "10.0.0.1", CMD_GET, specs[i].size, specs[i].slice);
+        wait_queued(i + 1);
+    }
+    sched_release(gate, 1);
+    sched_end(gate);
+    sched_flow_close(gate);
+
+    int last = 0;
+    while (!last) {
+        pthread_mutex_lock(&test.lock);
+        while (!test.holder) {
+            pthread_cond_wait(&test.cond, &test.lock);
+        }
+        int backlogged = 0;
+        for (int i = 0; i < count; i++) {
+            if (&flows[i] != test.holder && flows[i].remaining > 0) backlogged++;
+        }
+        last = backlogged == 0 && test.holder->remaining == 0;
+        pthread_mutex_unlock(&test.lock);
+
+        wait_queued(backlogged);
+
+        pthread_mutex_lock(&test.lock);
+        test.holder = NULL;
+        pthread_cond_broadcast(&test.cond);
+        pthread_mutex_unlock(&test.lock);
+    }
+
+    join_flows(flows, count);
+    return test.order;
+}
+
+/**
+ * Check the DRR bound on the last stepped run: whenever two flows both
+ * still have bytes to move, their granted bytes differ by at most one
+ * quantum plus one slice
+ */
+static void expect_fair(const char *what, const FlowSpec *specs, int count, long quantum) {
+    long moved[MAX_FLOWS] = { 0 };
+    long worst = 0;
+    for (int g = 0; g < test.grants; g++) {
+        for (int i = 0; i < count; i++) {
+            if (specs[i].name == test.order[g]) moved[i] += test.granted[g];
+        }
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < count; j++) {
+                if (moved[i] < specs[i].size && moved[j] < specs[j].size && moved[i] - moved[j] > worst) {
+                    worst = moved[i] - moved[j];
+                }
+            }
+        }
+    }
+    expect(what, worst <= quantum + BUFFER_SIZE);
+}
+
+/**
+ * Check the class rule on the last stepped run, for one bulk flow named
+ * 'b' and two interactive flows: while both interactive flows have work,
+ * bulk gets one grant after every SCHED_BULK_EVERY interactive ones. The
+ * grant right after a bulk slice is made before the bulk flow has queued
+ * again, so it doesn't count towards the streak.
+ */
+static void expect_bulk_spacing(const char *what) {
+    // Stop where the first interactive flow finishes
+    int end = test.grants;
+    for (int g = 0; g < test.grants; g++) {
+        if (test.order[g] == 'b') continue;
+        int later = 0;
+        for (int h = g + 1; h < test.grants; h++) {
+            if (test.order[h] == test.order[g]) later = 1;
+        }
+        if (!later && g < end) end = g;
+    }
+
+    int streak = 0, bulk_grants = 0, ok = 1;
+    for (int g = 0; g < end; g++) {
+        if (test.order[g] != 'b') {
+            streak++;
+            continue;
+        }
+        if (streak != (bulk_grants == 0 ? SCHED_BULK_EVERY : SCHED_BULK_EVERY + 1)) ok = 0;
+        bulk_grants++;
+        streak = 0;
+    }
+    expect(what, ok && bulk_grants > 1);
+}
+
+/**
+ * Time free-running flows and check the rate caps
+ */
+static void check_rates(void) {
+    enum { RATE = 256 * 1024, PART = 192 * 1024 };
+    SchedConfig config;
+    sched_config_init(&config);
+
+    // A per-client cap is shared by that client's connections but not by
+    // other clients. The bucket starts with a second of burst and may run
+    // one slice into debt, so two connections moving 1.5 s worth of bytes
+    // need at least (2 * PART - RATE - BUFFER_SIZE) / RATE seconds.
+    double floor_s = (2.0 * PART - RATE - BUFFER_SIZE) / RATE;
+    TestFlow flows[3];
+    config.client_rate = RATE;
+    reset(&config, 0);
+    double start = sched_now();
+    start_flow(&flows[0], 'A', "10.0.0.1", CMD_GET, PART, BUFFER_SIZE);
+    start_flow(&flows[1], 'B', "10.0.0.1", CMD_WRITE, PART, BUFFER_SIZE);
+    start_flow(&flows[2], 'C', "10.0.0.2", CMD_GET, PART, BUFFER_SIZE);
+    join_flows(flows, 3);
+    double shared = (flows[0].finished > flows[1].finished ? flows[0].finished : flows[1].finished) - start;
+    expect("client cap holds across a client's connections", shared >= floor_s);
+    expect("client cap releases credit as it accrues", shared < floor_s + 1.0);
+    expect("client cap is per client", flows[2].finished - start < floor_s / 2);
+
+    // A per-operation cap is shared by every client doing that operation,
+    // and doesn't hold back other operations
+    config.client_rate = 0;
+    config.op_rate[CMD_GET] = RATE;
+    reset(&config, 0);
+    start = sched_now();
+    start_flow(&flows[0], 'A', "10.0.0.1", CMD_GET, PART, BUFFER_SIZE);
+    start_flow(&flows[1], 'B', "10.0.0.2", CMD_GET, PART, BUFFER_SIZE);
+    start_flow(&flows[2], 'C', "10.0.0.3", CMD_WRITE, 2 * PART, BUFFER_SIZE);
+    join_flows(flows, 3);
+    shared = (flows[0].finished > flows[1].finished ? flows[0].finished : flows[1].finished) - start;
+    expect("operation cap holds across clients", shared >= floor_s);
+    expect("operation cap releases credit as it accrues", shared < floor_s + 1.0);
+    expect("operation cap leaves other operations alone", flows[2].finished - start < floor_s / 2);
+}
+
+/**
+ * Run the checks
+ *
+ * @return 0 if every check passed, 1 otherwise
+ */
+int main(void) {
+    SchedConfig config;
+    sched_config_init(&config);
+
+    // With a one-slice quantum every flow gets one slice per round
+    config.quantum = BUFFER_SIZE;
+    FlowSpec equal[] = { { 'A', 4 * BUFFER_SIZE, BUFFER_SIZE }, { 'B', 4 * BUFFER_SIZE, BUFFER_SIZE },
+                         { 'C', 4 * BUFFER_SIZE, BUFFER_SIZE } };
+    const char *order = stepped_order(config, equal, 3);
+    expect("round robin with a one-slice quantum", strcmp(order, "ABCABCABCABC") == 0);
+
+    // Larger quanta and unequal slices: bytes, not grants, are shared out
+    config.quantum = 2 * BUFFER_SIZE;
+    stepped_order(config, equal, 3);
+    expect_fair("DRR bound with a two-slice quantum", equal, 3, config.quantum);
+
+    FlowSpec mixed[] = { { 'A', 8 * BUFFER_SIZE, BUFFER_SIZE }, { 'B', 2 * BUFFER_SIZE, BUFFER_SIZE / 4 },
+                         { 'C', 8 * BUFFER_SIZE, BUFFER_SIZE }, { 'D', 4 * BUFFER_SIZE, BUFFER_SIZE / 2 } };
+    stepped_order(config, mixed, 4);
+    expect_fair("DRR bound with mixed slice sizes", mixed, 4, config.quantum);
+
+    // Interactive transfers go first, but bulk is served every SCHED_BULK_EVERY grants
+    config.quantum = BUFFER_SIZE;
+    config.small_size = 8 * 1024;
+    FlowSpec classes[] = { { 'b', 4 * BUFFER_SIZE, BUFFER_SIZE }, { 'I', 8 * 1024, 512 },
+                           { 'J', 8 * 1024, 512 } };
+    stepped_order(config, classes, 3);
+    expect_bulk_spacing("bulk served after every SCHED_BULK_EVERY interactive grants");
+
+    FlowSpec interactive_only[] = { { 'I', 4 * 512, 512 }, { 'b', 2 * BUFFER_SIZE, BUFFER_SIZE },
+                                    { 'J', 4 * 512, 512 } };
+    order = stepped_order(config, interactive_only, 3);
+    expect("interactive flows overtake a bulk flow queued ahead of them", strncmp(order, "IJIJ", 4) == 0);
+
+    check_rates();
+
+    printf("rfs_sched: %d/%d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -6,7 +6,10 @@
  * rfs_server.c -- TCP Socket Server
  *
  * Multithreaded remote file system server implementation
- * Supports write, get, and delete operations with reader-writer synchronization
+ * Supports write, get, and delete operations. Uploads are written to a
+ * temporary file and renamed into place, so readers always see a complete
+ * file and no lock is held across a transfer; bandwidth is shared between
+ * connections by the fair-share scheduler in rfs_sched.c.
  */
 
 #include <stdio.h>
@@ -18,35 +21,35 @@
 #include <signal.h>
 #include <sys/stat.h>
 #include <limits.h>
-
-/* Multithreading and synchronization libraries */
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <dirent.h>
+#include "rfs_sched.h"
+#include "rfs_crc32c.h"
+#include "rfs_log.h"
+
+/* Multithreading library */
 #include <pthread.h>
-#include <semaphore.h>
 
-// Semaphores for reader-writer synchronization
-sem_t x, y;  // x: read lock, y: write lock
 pthread_t tid;
 
-// Thread arrays for different operation types
-pthread_t writethreads[100];
-pthread_t getthreads[100];
-pthread_t deletethreads[100];
-
-int readercount = 0;  // Number of concurrent readers
-
 // Global socket descriptor for signal handling
 int socket_desc;
 
+// Set by the signal handler; the accept loop exits and flushes the log
+volatile sig_atomic_t shutdown_requested = 0;
+
 /**
  * Signal handler for graceful server shutdown
- * Closes socket and exits on SIGINT (Ctrl+C)
+ * Closes the listening socket on SIGINT (Ctrl+C) so the accept loop ends
  * 
  * @param sig Signal number received
  */
 void signal_handler(int sig) {
     write(STDERR_FILENO, "Caught SIGINT!\n", 15);
+    shutdown_requested = 1;
     close(socket_desc);
-    exit(0);
 }
 
 /**
@@ -90,12 +93,11 @@ void create_server_directories(const char *filepath) {
  * Delete a file or directory
  * 
  * @param filepath Path to file or directory to be deleted
- * @return 0 on success, -1 on error
+ * @return 0 on success, -1 on error (errno is set)
  */
 int delete_file_or_directory(const char *filepath) {
     struct stat path_stat;
     if (stat(filepath, &path_stat) != 0) {
-        perror("File/directory does not exist");
         return -1;
     }
 
@@ -108,166 +110,544 @@ int delete_file_or_directory(const char *filepath) {
 }
 
 /**
- * Thread function to handle file retrieval (GET) operation
- * Implements reader synchronization using semaphores
+ * Create a temporary file in the staging directory
+ * Staged files can't be reached by GET or RM; the caller renames the file
+ * over its destination once it is complete
  * 
- * @param server_thread_data Pointer to ServerThreadData containing operation details
- * @return 0 on completion
+ * @param tmp_path Buffer of PATH_MAX bytes receiving the temporary path
+ * @return Open file, or NULL on error
  */
-void* process_get(void* server_thread_data) {   
-    printf("\nRead is trying to enter");
-    
-    // Acquire read lock
-    sem_wait(&x);
+FILE *create_temp_file(char *tmp_path) {
+    snprintf(tmp_path, PATH_MAX, "%supload.XXXXXX", SERVER_STAGING_ROOT);
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        return NULL;
+    }
+    // mkstemp creates the file private to the owner; match fopen's permissions
+    fchmod(fd, 0644);
+    FILE *file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        unlink(tmp_path);
+    }
+    return file;
+}
 
-    ServerThreadData data = *((ServerThreadData*)server_thread_data);
-    printf("\nRead entered");
+/**
+ * Remove uploads left in the staging directory by a previous run
+ */
+void clear_staging_directory(void) {
+    DIR *dir = opendir(SERVER_STAGING_ROOT);
+    if (!dir) return;
+
+    struct dirent *entry;
+    char path[PATH_MAX];
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        snprintf(path, sizeof(path), "%s%s", SERVER_STAGING_ROOT, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
 
-    int open = 1;
-    FILE *file = fopen(data.full_path, "rb");
-    if (!file) {
-        perror("Error opening server file");
+/**
+ * Modification time of a file in nanoseconds
+ * Whole seconds would let a file rewritten within the same second keep
+ * matching its old digest
+ * 
+ * @param file_stat Status of the file
+ * @return Modification time since the epoch, in nanoseconds
+ */
+int64_t stat_mtime_ns(const struct stat *file_stat) {
+    return (int64_t)file_stat->st_mtim.tv_sec * 1000000000 + file_stat->st_mtim.tv_nsec;
+}
+
+/**
+ * Open the stored digest of a file if it matches the file's current version
+ * On success the returned stream is positioned at the first chunk CRC
+ * 
+ * @param meta_path Path of the stored digest
+ * @param file_stat Status of the open data file
+ * @param header Filled with the digest header
+ * @return Open digest, or NULL if there is no usable digest
+ */
+FILE *open_digest(const char *meta_path, const struct stat *file_stat, DigestHeader *header) {
+    FILE *digest = fopen(meta_path, "rb");
+    if (!digest) {
+        return NULL;
+    }
+
+    // The digest must describe this exact file with today's chunking
+    long chunks = (file_stat->st_size + BUFFER_SIZE - 1) / BUFFER_SIZE;
+    if (fread(header, sizeof(*header), 1, digest) != 1 ||
+            header->magic != DIGEST_MAGIC ||
+            header->chunk_size != BUFFER_SIZE ||
+            header->inode != (uint64_t)file_stat->st_ino ||
+            header->size != (int64_t)file_stat->st_size ||
+            header->mtime_ns != stat_mtime_ns(file_stat) ||
+            header->chunks != (uint32_t)chunks) {
+        fclose(digest);
+        return NULL;
+    }
+    return digest;
+}
+
+/**
+ * Handle a file retrieval (GET) request
+ * The file is streamed in scheduler-granted slices. Chunk CRCs come from
+ * the stored digest when it is current, so the data isn't rehashed; the
+ * client still verifies every chunk against them.
+ * 
+ * @param data Pointer to ServerThreadData containing operation details
+ * @return 0 if the connection can serve further requests, -1 otherwise
+ */
+int process_get(ServerThreadData *data) {   
+    log_msg(LOG_LEVEL_DEBUG, data->trace_id, "GET %s", data->cmd.remote_path);
+
+    int result = 0;
+    int status = 0;
+    long bytes_sent = 0;
+    struct stat file_stat;
+    FILE *file = fopen(data->full_path, "rb");
+    if (!file || fstat(fileno(file), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+        log_errno(LOG_LEVEL_WARN, data->trace_id, errno, "Error opening server file %s", data->cmd.remote_path);
+        if (file) fclose(file);
+        status = -1;
+
+        // Tell the client the file is unavailable so the connection stays usable
+        long filesize = -1;
+        if (rfs_send_all(data->client_sock, &filesize, sizeof(filesize)) < 0) {
+            log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error sending file size");
+            result = -1;
+        }
     } else {
-        // Get file size
-        fseek(file, 0, SEEK_END);
-        long filesize = ftell(file);
-        rewind(file);
+        long filesize = file_stat.st_size;
+        DigestHeader header;
+        FILE *digest = open_digest(data->meta_path, &file_stat, &header);
 
         // Send file size to client
-        if (send(data.client_sock, &filesize, sizeof(filesize), 0) <= 0) {
-            perror("Error sending file size");
-            open = 0;
-            fclose(file);
+        if (rfs_send_all(data->client_sock, &filesize, sizeof(filesize)) < 0) {
+            log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error sending file size");
+            result = -1;
         } else {
-            // Send file contents in chunks
-            char buffer[BUFFER_SIZE];
-            size_t bytes_read;
-            while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
-                if (send(data.client_sock, buffer, bytes_read, 0) <= 0) {
-                    perror("Error sending file data");
-                    open = 0;
-                    fclose(file);
+            // Send exactly filesize bytes, one granted chunk at a time
+            sched_begin(data->flow, CMD_GET, filesize);
+            char buffer[BUFFER_SIZE + sizeof(uint32_t)];
+            PayloadDigest computed;
+            rfs_digest_init(&computed);
+            while (bytes_sent < filesize) {
+                size_t chunk_size = (filesize - bytes_sent > BUFFER_SIZE)
+                    ? BUFFER_SIZE : (filesize - bytes_sent);
+
+                // Don't take a slot while the client isn't draining the socket
+                struct pollfd pfd = { data->client_sock, POLLOUT, 0 };
+                poll(&pfd, 1, -1);
+
+                // The grant covers reading the chunk; it is sent after the
+                // slot is released so a client that stops reading can't hold it
+                sched_acquire(data->flow, chunk_size);
+                if (bytes_sent == 0) {
+                    trace_event(TRACE_LOCK_ACQUIRE, data->trace_id, data->conn_id, CMD_GET, 0, 0);
+                }
+                if (fread(buffer, 1, chunk_size, file) != chunk_size) {
+                    // File shrank underneath us; the promised size can't be met
+                    sched_release(data->flow, 0);
+                    log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error reading server file %s", data->cmd.remote_path);
+                    result = -1;
+                    break;
+                }
+
+                uint32_t crc;
+                if (!digest || fread(&crc, sizeof(crc), 1, digest) != 1) {
+                    crc = rfs_crc32c(0, buffer, chunk_size);
+                }
+                if (!digest) {
+                    rfs_digest_add(&computed, crc, chunk_size);
+                }
+                memcpy(buffer + chunk_size, &crc, sizeof(crc));
+                sched_release(data->flow, chunk_size);
+
+                if (rfs_send_all(data->client_sock, buffer, chunk_size + sizeof(crc)) < 0) {
+                    log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error sending file data");
+                    result = -1;
                     break;
                 }
+                if (bytes_sent == 0) {
+                    trace_event(TRACE_FIRST_BYTE, data->trace_id, data->conn_id, CMD_GET, 0, 0);
+                }
+                bytes_sent += chunk_size;
             }
-        }
-    }
+            sched_end(data->flow);
 
-    // Close file if still open
-    if(open == 1) {
+            // Finish with the whole-file CRC
+            uint32_t file_crc = digest ? header.file_crc : computed.file_crc;
+            if (result == 0 && rfs_send_all(data->client_sock, &file_crc, sizeof(file_crc)) < 0) {
+                log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error sending file digest");
+                result = -1;
+            }
+        }
+        if (digest) fclose(digest);
         fclose(file);
     }
 
-    // Release read lock
-    sem_post(&x);
-    
-    printf("\nRead is leaving");
-    close(data.client_sock);
-    pthread_exit(NULL);
-    return 0;
+    if (result < 0) status = -1;
+    trace_event(TRACE_COMPLETE, data->trace_id, data->conn_id, CMD_GET, bytes_sent, status);
+    log_msg(LOG_LEVEL_DEBUG, data->trace_id, "GET done, %ld bytes, status %d", bytes_sent, status);
+    return result;
 }
 
 /**
- * Thread function to handle file write (WRITE) operation
- * Implements writer synchronization using semaphores
+ * Handle a file write (WRITE) request
+ * Data is received into a temporary file in scheduler-granted chunks,
+ * each verified against its CRC32C, and renamed over the destination once
+ * complete. The chunk CRCs are stored as the file's digest for later GETs.
  * 
- * @param server_thread_data Pointer to ServerThreadData containing operation details
- * @return 0 on completion
+ * @param data Pointer to ServerThreadData containing operation details
+ * @return 0 if the connection can serve further requests, -1 otherwise
  */
-void* process_write(void* server_thread_data) {
-    printf("\nWriter is trying to enter");
+int process_write(ServerThreadData *data) {
+    log_msg(LOG_LEVEL_DEBUG, data->trace_id, "WRITE %s", data->cmd.remote_path);
+
+    // Receive file size
+    long filesize;
+    if (rfs_recv_all(data->client_sock, &filesize, sizeof(filesize)) != sizeof(filesize)) {
+        log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error receiving file size");
+        trace_event(TRACE_COMPLETE, data->trace_id, data->conn_id, CMD_WRITE, 0, -1);
+        return -1;
+    }
 
-    // Acquire write lock
-    sem_wait(&y);
+    // Stage the upload and its digest; they are renamed into place when complete
+    create_server_directories(data->full_path);
+    char tmp_path[PATH_MAX];
+    FILE *file = create_temp_file(tmp_path);
+    if (!file) {
+        log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error creating server file %s", data->cmd.remote_path);
+    }
 
-    ServerThreadData data = *((ServerThreadData*)server_thread_data);
-    printf("\nWriter has entered");
+    char tmp_meta_path[PATH_MAX];
+    FILE *digest = NULL;
+    DigestHeader header;
+    memset(&header, 0, sizeof(header));
+    if (file) {
+        // The digest is an optimization; GETs fall back to hashing without it
+        create_server_directories(data->meta_path);
+        digest = create_temp_file(tmp_meta_path);
+        if (digest && fwrite(&header, sizeof(header), 1, digest) != 1) {
+            fclose(digest);
+            unlink(tmp_meta_path);
+            digest = NULL;
+        }
+    }
 
-    // Ensure directory structure exists
-    create_server_directories(data.full_path);
+    // Receive file contents in chunks, draining them even if the file
+    // could not be opened so the next request starts at the right offset
+    int result = 0;
+    int status = file ? 0 : -1;
+    int intact = 1;
+    char buffer[BUFFER_SIZE + sizeof(uint32_t)];
+    PayloadDigest computed;
+    rfs_digest_init(&computed);
+    long bytes_received = 0;
+    sched_begin(data->flow, CMD_WRITE, filesize);
+    while (bytes_received < filesize) {
+        size_t chunk_size = (filesize - bytes_received > BUFFER_SIZE)
+            ? BUFFER_SIZE : (filesize - bytes_received);
+
+        // Receive the whole chunk before asking for a slot, so a client
+        // that stalls mid-chunk only holds up its own connection
+        ssize_t received = rfs_recv_all(data->client_sock, buffer, chunk_size + sizeof(uint32_t));
+        if (received != (ssize_t)(chunk_size + sizeof(uint32_t))) {
+            log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error receiving file data");
+            result = -1;
+            status = -1;
+            break;
+        }
 
-    // Open file for writing
-    FILE *file = fopen(data.full_path, "wb");
-    if (!file) {
-        perror("Error creating server file");
-    } else {
-        // Receive file size
-        long filesize;
-        if (recv(data.client_sock, &filesize, sizeof(filesize), 0) <= 0) {
-            perror("Error receiving file size");
-            fclose(file);
-        } else {
-            // Receive file contents in chunks
-            char buffer[BUFFER_SIZE];
-            long bytes_received = 0;
-            ssize_t received;
-            while (bytes_received < filesize) {
-                received = recv(data.client_sock, buffer, BUFFER_SIZE, 0);
-                if (received <= 0) {
-                    perror("Error receiving file data");
-                    fclose(file);
-                    break;
-                }
-                fwrite(buffer, 1, received, file);
-                bytes_received += received;
-            }
-            fclose(file);
+        if (bytes_received == 0) {
+            trace_event(TRACE_FIRST_BYTE, data->trace_id, data->conn_id, CMD_WRITE, 0, 0);
+        }
+
+        // Verify the chunk before it is written
+        uint32_t expected;
+        memcpy(&expected, buffer + chunk_size, sizeof(expected));
+        uint32_t crc = rfs_crc32c(0, buffer, chunk_size);
+        if (crc != expected) {
+            intact = 0;
+        }
+        rfs_digest_add(&computed, crc, chunk_size);
+
+        // The grant covers committing the chunk to disk
+        sched_acquire(data->flow, chunk_size);
+        if (bytes_received == 0) {
+            trace_event(TRACE_LOCK_ACQUIRE, data->trace_id, data->conn_id, CMD_WRITE, 0, 0);
+        }
+        if (file && intact && fwrite(buffer, 1, chunk_size, file) != chunk_size) {
+            log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error writing server file %s", data->cmd.remote_path);
+            status = -1;
+        }
+        sched_release(data->flow, chunk_size);
+        if (digest && fwrite(&crc, sizeof(crc), 1, digest) != 1) {
+            fclose(digest);
+            unlink(tmp_meta_path);
+            digest = NULL;
+        }
+        bytes_received += chunk_size;
+    }
+    sched_end(data->flow);
+
+    // Check the whole-file CRC
+    if (result == 0) {
+        uint32_t file_crc;
+        if (rfs_recv_all(data->client_sock, &file_crc, sizeof(file_crc)) != sizeof(file_crc)) {
+            log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error receiving file digest");
+            result = -1;
+            status = -1;
+        } else if (!intact || file_crc != computed.file_crc) {
+            log_msg(LOG_LEVEL_WARN, data->trace_id, "Checksum mismatch on upload of %s", data->cmd.remote_path);
+            if (status == 0) status = RFS_STATUS_CORRUPT;
         }
     }
 
-    // Release write lock
-    sem_post(&y);
+    // Publish the upload atomically, or discard it
+    struct stat file_stat;
+    if (file) {
+        if (fflush(file) != 0 || fstat(fileno(file), &file_stat) != 0) {
+            status = -1;
+        }
+        if (fclose(file) != 0) {
+            status = -1;
+        }
+        if (status == 0 && rename(tmp_path, data->full_path) != 0) {
+            log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error publishing server file %s", data->cmd.remote_path);
+            status = -1;
+        }
+        if (status != 0) {
+            unlink(tmp_path);
+        }
+    }
 
-    printf("\nWriter is leaving");
-    close(data.client_sock);
-    pthread_exit(NULL);
-    return 0;
+    // Store the digest for the version just published
+    if (digest) {
+        header.magic = DIGEST_MAGIC;
+        header.chunk_size = BUFFER_SIZE;
+        header.file_crc = computed.file_crc;
+        header.chunks = (filesize + BUFFER_SIZE - 1) / BUFFER_SIZE;
+        if (status == 0) {
+            header.inode = file_stat.st_ino;
+            header.size = file_stat.st_size;
+            header.mtime_ns = stat_mtime_ns(&file_stat);
+        }
+        int stored = status == 0 &&
+            fseek(digest, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, digest) == 1;
+        if (fclose(digest) != 0) stored = 0;
+        if (!stored || rename(tmp_meta_path, data->meta_path) != 0) {
+            unlink(tmp_meta_path);
+        }
+    }
+
+    // Acknowledge the upload
+    if (result == 0 && rfs_send_all(data->client_sock, &status, sizeof(status)) < 0) {
+        log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error sending write status");
+        result = -1;
+    }
+
+    trace_event(TRACE_COMPLETE, data->trace_id, data->conn_id, CMD_WRITE, bytes_received, status);
+    log_msg(LOG_LEVEL_DEBUG, data->trace_id, "WRITE done, %ld bytes, status %d", bytes_received, status);
+    return result;
 }
 
 /**
- * Thread function to handle file deletion (RM) operation
- * Uses write lock for exclusive access
+ * Handle a file deletion (RM) request
+ * Removal is a single atomic filesystem call, so it needs no scheduling
  * 
- * @param server_thread_data Pointer to ServerThreadData containing operation details
+ * @param data Pointer to ServerThreadData containing operation details
+ * @return 0 if the connection can serve further requests, -1 otherwise
+ */
+int process_delete(ServerThreadData *data) {
+    log_msg(LOG_LEVEL_DEBUG, data->trace_id, "RM %s", data->cmd.remote_path);
+
+    // Attempt to delete file or directory, then any stored digest
+    int status = delete_file_or_directory(data->full_path);
+    if (status == 0) {
+        unlink(data->meta_path);
+    } else {
+        log_errno(LOG_LEVEL_WARN, data->trace_id, errno, "Error deleting %s", data->cmd.remote_path);
+    }
+
+    // Send deletion status back to client
+    int result = 0;
+    if (rfs_send_all(data->client_sock, &status, sizeof(status)) < 0) {
+        log_errno(LOG_LEVEL_ERROR, data->trace_id, errno, "Error sending delete status");
+        result = -1;
+    }
+
+    trace_event(TRACE_COMPLETE, data->trace_id, data->conn_id, CMD_RM, 0, status);
+    return result;
+}
+
+/**
+ * Thread function serving one client connection
+ * Reads commands until the client closes the connection, so a client
+ * can reuse one connection for many requests
+ * 
+ * @param server_thread_data Heap-allocated ServerThreadData owned by this thread
  * @return 0 on completion
  */
-void* process_delete(void* server_thread_data) {
-    printf("\nDelete started");
+void* process_connection(void* server_thread_data) {
+    ServerThreadData *data = (ServerThreadData*)server_thread_data;
+
+    data->flow = sched_flow_open(data->client_addr);
+    while (data->flow) {
+        // Receive next command; a clean close between commands ends the session
+        ssize_t received = rfs_recv_all(data->client_sock, &data->cmd, sizeof(data->cmd));
+        if (received != sizeof(data->cmd)) {
+            if (received != 0) {
+                log_errno(LOG_LEVEL_ERROR, 0, received < 0 ? errno : 0, "Error receiving command on connection %u", data->conn_id);
+            }
+            break;
+        }
 
-    // Acquire write lock
-    sem_wait(&y);
+        // Every command is a new request with its own trace ID
+        data->trace_id = trace_next_id();
+        trace_event(TRACE_REQUEST, data->trace_id, data->conn_id, data->cmd.type, 0, 0);
+        data->cmd.remote_path[PATH_MAX - 1] = '\0';
+        if (snprintf(data->full_path, sizeof(data->full_path), "%s%s", SERVER_ROOT, data->cmd.remote_path)
+                >= (int)sizeof(data->full_path) ||
+            snprintf(data->meta_path, sizeof(data->meta_path), "%s%s.crc", SERVER_META_ROOT, data->cmd.remote_path)
+                >= (int)sizeof(data->meta_path)) {
+            log_msg(LOG_LEVEL_WARN, data->trace_id, "Remote path too long");
+            break;
+        }
 
-    ServerThreadData data = *((ServerThreadData*)server_thread_data);
-    
-    // Attempt to delete file or directory
-    int result = delete_file_or_directory(data.full_path);
+        int result;
+        switch (data->cmd.type) {
+            case CMD_WRITE:
+                result = process_write(data);
+                break;
+            case CMD_GET:
+                result = process_get(data);
+                break;
+            case CMD_RM:
+                result = process_delete(data);
+                break;
+            default:
+                log_msg(LOG_LEVEL_WARN, data->trace_id, "Unknown command %d", data->cmd.type);
+                result = -1;
+        }
+        if (result < 0) break;
+    }
 
-    // Send deletion status back to client
-    send(data.client_sock, &result, sizeof(result), 0);
+    log_msg(LOG_LEVEL_DEBUG, 0, "Connection %u closed", data->conn_id);
+    sched_flow_close(data->flow);
+    close(data->client_sock);
+    free(data);
+    return 0;
+}
 
-    // Release write lock
-    sem_post(&y);
+/**
+ * Parse a byte count with an optional K, M or G suffix
+ * 
+ * @param text String to parse
+ * @param value Set to the parsed value
+ * @return 0 on success, -1 on invalid input
+ */
+int parse_size(const char *text, long *value) {
+    char *end;
+    long number = strtol(text, &end, 10);
+    if (end == text || number < 0) return -1;
+
+    switch (*end) {
+        case 'G': case 'g': number *= 1024;  // fall through
+        case 'M': case 'm': number *= 1024;  // fall through
+        case 'K': case 'k': number *= 1024; end++; break;
+        default: break;
+    }
+    if (*end != '\0') return -1;
 
-    printf("\nDelete is leaving");
-    close(data.client_sock);
-    pthread_exit(NULL);
+    *value = number;
     return 0;
 }
 
+/**
+ * Print command-line usage for the server
+ * 
+ * @param prog Program name
+ */
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  -q bytes  Scheduler quantum per connection per round (default %d)\n", SCHED_DEFAULT_QUANTUM);
+    fprintf(stderr, "  -s slots  Concurrent transfer slices (default %d)\n", SCHED_DEFAULT_SLOTS);
+    fprintf(stderr, "  -i bytes  Largest transfer given interactive priority (default %d)\n", SCHED_DEFAULT_SMALL);
+    fprintf(stderr, "  -c rate   Bandwidth cap per client address, bytes/s\n");
+    fprintf(stderr, "  -g rate   Bandwidth cap for all GETs, bytes/s\n");
+    fprintf(stderr, "  -w rate   Bandwidth cap for all WRITEs, bytes/s\n");
+    fprintf(stderr, "  -l file   Log file, - for stderr (default %s)\n", DEFAULT_LOG_PATH);
+    fprintf(stderr, "  -t file   Write a binary request trace to file (read it with rfstrace)\n");
+    fprintf(stderr, "  -v level  Log level: debug, info, warn or error (default info)\n");
+    fprintf(stderr, "Sizes and rates accept K, M and G suffixes; 0 means unlimited\n");
+}
+
 /**
  * Main server function
- * Sets up socket, handles client connections, and spawns threads for operations
+ * Sets up socket, accepts client connections, and spawns a thread per connection
  * 
- * @return 0 on successful execution (never reaches in this implementation)
+ * @param argc Number of command-line arguments
+ * @param argv Scheduler and logging options, see print_usage
+ * @return 0 after a clean shutdown, -1 on startup error
  */
-int main(void) {
+int main(int argc, char *argv[]) {
     int client_sock;
     socklen_t client_size;
     struct sockaddr_in server_addr, client_addr;
 
-    // Initialize semaphores for synchronization
-    sem_init(&x, 0, 1);
-    sem_init(&y, 0, 1);
+    // Parse scheduler and logging options
+    SchedConfig sched_config;
+    sched_config_init(&sched_config);
+    const char *log_path = DEFAULT_LOG_PATH;
+    const char *trace_path = NULL;
+    LogLevel level = LOG_LEVEL_INFO;
+    int opt;
+    while ((opt = getopt(argc, argv, "q:s:i:c:g:w:l:t:v:")) != -1) {
+        long value;
+        if (opt == 'l') {
+            log_path = optarg;
+            continue;
+        }
+        if (opt == 't') {
+            trace_path = optarg;
+            continue;
+        }
+        if (opt == 'v') {
+            if (log_parse_level(optarg, &level) < 0) {
+                print_usage(argv[0]);
+                return -1;
+            }
+            continue;
+        }
+        if (opt == '?' || parse_size(optarg, &value) < 0) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        switch (opt) {
+            case 'q': sched_config.quantum = value; break;
+            case 's': sched_config.slots = value; break;
+            case 'i': sched_config.small_size = value; break;
+            case 'c': sched_config.client_rate = value; break;
+            case 'g': sched_config.op_rate[CMD_GET] = value; break;
+            case 'w': sched_config.op_rate[CMD_WRITE] = value; break;
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+    if (optind != argc) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // Initialize the I/O scheduler
+    sched_init(&sched_config);
 
     // Set up signal handler for graceful shutdown
     struct sigaction sa;
@@ -281,6 +661,9 @@ int main(void) {
         return -1;
     }
 
+    // A client disconnecting mid-transfer must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
     // Create socket
     socket_desc = socket(AF_INET, SOCK_STREAM, 0);
     if (socket_desc < 0) {
@@ -306,8 +689,11 @@ int main(void) {
         return -1;
     }
 
-    // Create server root directory
+    // Create server root, digest and staging directories
     mkdir(SERVER_ROOT, 0755);
+    mkdir(SERVER_META_ROOT, 0755);
+    mkdir(SERVER_STAGING_ROOT, 0755);
+    clear_staging_directory();
 
     // Start listening for connections
     if (listen(socket_desc, 50) < 0) {
@@ -316,66 +702,64 @@ int main(void) {
         return -1;
     }
 
-    printf("Remote File System Server started. Listening on port %d...\n", PORT);
+    // Start the logger; request threads log through it from here on
+    if (log_init(log_path, trace_path, level) < 0) {
+        perror("Error opening log or trace file");
+        close(socket_desc);
+        return -1;
+    }
 
-    int i = 0;
-    int max_connections = 50;
+    printf("Remote File System Server started. Listening on port %d...\n", PORT);
+    printf("Verifying transfers with CRC32C (%s)\n", rfs_crc32c_impl());
+    log_msg(LOG_LEVEL_INFO, 0, "Server started on port %d", PORT);
 
     // Main server loop
-    while (1) {
+    uint32_t next_conn_id = 0;
+    while (!shutdown_requested) {
         // Accept incoming connection
         client_size = sizeof(client_addr);
         client_sock = accept(socket_desc, (struct sockaddr*)&client_addr, &client_size);
 
         if (client_sock < 0) {
-            perror("Can't accept connection");
+            if (!shutdown_requested) {
+                log_errno(LOG_LEVEL_ERROR, 0, errno, "Can't accept connection");
+            }
             continue;
         }
 
-        // Receive command from client
-        Command cmd;
-        if (recv(client_sock, &cmd, sizeof(cmd), 0) <= 0) {
-            perror("Error receiving command");
+        uint32_t conn_id = ++next_conn_id;
+        trace_event(TRACE_ACCEPT, 0, conn_id, 0, ntohl(client_addr.sin_addr.s_addr), 0);
+        log_msg(LOG_LEVEL_DEBUG, 0, "Connection %u from %s:%d", conn_id,
+                inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+
+        // Each connection gets its own thread data so threads never share a stack slot
+        ServerThreadData *server_thread_data = malloc(sizeof(ServerThreadData));
+        if (!server_thread_data) {
+            log_errno(LOG_LEVEL_ERROR, 0, errno, "Error allocating thread data");
             close(client_sock);
             continue;
         }
+        memset(server_thread_data, 0, sizeof(ServerThreadData));
+        server_thread_data->client_sock = client_sock;
+        server_thread_data->client_addr = client_addr.sin_addr;
+        server_thread_data->conn_id = conn_id;
 
-        // Prepare thread data
-        ServerThreadData server_thread_data;
-        memcpy(&server_thread_data.cmd, &cmd, sizeof(cmd));
-        memcpy(&server_thread_data.client_sock, &client_sock, sizeof(client_sock));
-        snprintf(server_thread_data.full_path, sizeof(server_thread_data.full_path), "%s%s", SERVER_ROOT, cmd.remote_path);
+        // Small replies (sizes, statuses) must not wait on Nagle
+        setsockopt(client_sock, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
 
-        // Create thread based on command type
-        int result = 0;
-        switch (cmd.type) {
-            case CMD_WRITE:
-                pthread_create(&writethreads[i++], NULL, process_write, &server_thread_data);
-                break;
-            case CMD_GET:
-                pthread_create(&getthreads[i++], NULL, process_get, &server_thread_data);
-                break;
-            case CMD_RM:
-                pthread_create(&deletethreads[i++], NULL, process_delete, &server_thread_data);
-                break;
-            default:
-                result = -1;
-        }
-
-        // Reset connection counter and join threads if max reached
-        if(i >= max_connections) {
-            i = 0;
-            while (i < max_connections) {
-                pthread_join(writethreads[i++], NULL);
-                pthread_join(getthreads[i++], NULL);
-                pthread_join(deletethreads[i++], NULL);
-            }
-            i = 0;
+        // Serve the connection on a detached thread
+        if (pthread_create(&tid, NULL, process_connection, server_thread_data) != 0) {
+            log_errno(LOG_LEVEL_ERROR, 0, errno, "Error creating connection thread");
+            close(client_sock);
+            free(server_thread_data);
+            continue;
         }
+        pthread_detach(tid);
     }
 
-    // Close server socket (unreachable in this implementation)
-    close(socket_desc);
+    // The signal handler already closed the listening socket; flush the log
+    log_msg(LOG_LEVEL_INFO, 0, "Server shutting down");
+    log_shutdown();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+/*
+ * Name: Zhengpeng Qiu and Blake Koontz
+ * Course: CS5600
+ * Semester: Fall 2024
+ *
+ * rfs_trace.c -- Turn a binary server trace into request timelines
+ *
+ * Reads the file written by `rfserver -t`, groups the records by request
+ * and prints one timeline per request followed by latency percentiles per
+ * operation. With -c the timelines are printed as CSV instead.
+ *
+ * "accept" is the time from accepting the connection to its first
+ * request; "lock", "1st_byte" and "total" are measured from the start of
+ * the request. A WRITE receives its first chunk before it asks for a
+ * scheduler slot, so its first byte comes before its lock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rfs.h"
+#include "rfs_log.h"
+
+#define NO_TIME UINT64_MAX   // Event not seen for a request
+
+/**
+ * Timeline of one request, assembled from its trace records
+ */
+typedef struct {
+    uint64_t trace_id;        // Request ID, 0 if the slot is unused
+    uint32_t conn_id;         // Connection that carried the request
+    int op;                   // CommandType
+    int first_on_conn;        // First request on its connection
+    uint64_t accept_ns;       // Connection accepted
+    uint64_t request_ns;      // Command received
+    uint64_t lock_ns;         // First scheduler grant
+    uint64_t first_byte_ns;   // First payload byte moved
+    uint64_t complete_ns;     // Request finished
+    uint64_t bytes;           // Payload bytes moved
+    int status;               // Request status
+} Timeline;
+
+/**
+ * Name of an operation for printing
+ */
+static const char *op_name(int op) {
+    switch (op) {
+        case CMD_WRITE: return "WRITE";
+        case CMD_GET: return "GET";
+        case CMD_RM: return "RM";
+        default: return "?";
+    }
+}
+
+/**
+ * Compare trace records by timestamp for qsort
+ */
+static int compare_records(const void *a, const void *b) {
+    const TraceRecord *x = a, *y = b;
+    return (x->timestamp_ns > y->timestamp_ns) - (x->timestamp_ns < y->timestamp_ns);
+}
+
+/**
+ * Compare durations for qsort
+ */
+static int compare_durations(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Grow an array so that index is valid, zeroing the new elements
+ *
+ * @param array Array to grow
+ * @param count Current element count, updated
+ * @param size Element size
+ * @param index Index that must be valid
+ * @return The array, or NULL if out of memory
+ */
+static void *grow(void *array, size_t *count, size_t size, size_t index) {
+    if (index < *count) return array;
+    size_t new_count = *count ? *count : 64;
+    while (new_count <= index) new_count *= 2;
+    char *grown = realloc(array, new_count * size);
+    if (!grown) return NULL;
+    memset(grown + *count * size, 0, (new_count - *count) * size);
+    *count = new_count;
+    return grown;
+}
+
+/**
+ * Format a duration between two events in milliseconds, "-" if either is missing
+ */
+static const char *span_ms(char *buf, size_t len, uint64_t from, uint64_t to) {
+    if (from == NO_TIME || to == NO_TIME) return "-";
+    snprintf(buf, len, "%.3f", (to - from) / 1e6);
+    return buf;
+}
+
+/**
+ * Print p50, p99 and max of a set of durations, in milliseconds
+ */
+static void print_percentiles(const char *label, uint64_t *durations, size_t count) {
+    if (count == 0) {
+        printf("  %-12s -\n", label);
+        return;
+    }
+    qsort(durations, count, sizeof(uint64_t), compare_durations);
+    printf("  %-12s p50 %9.3f  p99 %9.3f  max %9.3f ms\n", label,
+           durations[count / 2] / 1e6,
+           durations[(count * 99) / 100] / 1e6,
+           durations[count - 1] / 1e6);
+}
+
+/**
+ * Print command-line usage
+ *
+ * @param prog Program name
+ */
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-c] tracefile\n", prog);
+    fprintf(stderr, "  -c  Print request timelines as CSV (times in microseconds, -1 if the event did not occur)\n");
+}
+
+/**
+ * Main function
+ *
+ * @param argc Number of command-line arguments
+ * @param argv Options and trace file path
+ * @return 0 on success, -1 on error
+ */
+int main(int argc, char *argv[]) {
+    int csv = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "c")) != -1) {
+        switch (opt) {
+            case 'c': csv = 1; break;
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // Read and check the header
+    FILE *file = fopen(argv[optind], "rb");
+    if (!file) {
+        perror("Error opening trace file");
+        return -1;
+    }
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s is not an RFS trace file\n", argv[optind]);
+        fclose(file);
+        return -1;
+    }
+    if (header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)) {
+        fprintf(stderr, "Unsupported trace version %u\n", header.version);
+        fclose(file);
+        return -1;
+    }
+
+    // Load every record; each thread's records arrive in order, but the
+    // drain thread interleaves threads, so sort by time
+    size_t record_count = 0, record_cap = 0;
+    TraceRecord *records = NULL;
+    TraceRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        records = grow(records, &record_cap, sizeof(TraceRecord), record_count);
+        if (!records) {
+            perror("Error reading trace");
+            fclose(file);
+            return -1;
+        }
+        records[record_count++] = record;
+    }
+    fclose(file);
+    qsort(records, record_count, sizeof(TraceRecord), compare_records);
+
+    // Group records into timelines; trace and connection IDs are dense
+    size_t timeline_cap = 0, accept_cap = 0;
+    Timeline *timelines = NULL;
+    uint64_t *accepts = NULL;       // Accept time per connection, 0 if unseen
+    uint64_t *conn_requests = NULL; // Requests seen so far per connection
+    size_t conn_requests_cap = 0;
+    for (size_t i = 0; i < record_count; i++) {
+        TraceRecord *r = &records[i];
+        if (r->event == TRACE_ACCEPT) {
+            accepts = grow(accepts, &accept_cap, sizeof(uint64_t), r->conn_id);
+            if (!accepts) goto out_of_memory;
+            accepts[r->conn_id] = r->timestamp_ns;
+            continue;
+        }
+
+        timelines = grow(timelines, &timeline_cap, sizeof(Timeline), r->trace_id);
+        if (!timelines) goto out_of_memory;
+        Timeline *t = &timelines[r->trace_id];
+        if (t->trace_id == 0) {
+            t->trace_id = r->trace_id;
+            t->conn_id = r->conn_id;
+            t->op = r->op;
+            t->accept_ns = t->request_ns = t->lock_ns = t->first_byte_ns = t->complete_ns = NO_TIME;
+            t->status = 0;
+        }
+
+        switch (r->event) {
+            case TRACE_REQUEST:
+                t->request_ns = r->timestamp_ns;
+                conn_requests = grow(conn_requests, &conn_requests_cap, sizeof(uint64_t), r->conn_id);
+                if (!conn_requests) goto out_of_memory;
+                t->first_on_conn = conn_requests[r->conn_id]++ == 0;
+                if (t->first_on_conn && r->conn_id < accept_cap && accepts[r->conn_id]) {
+                    t->accept_ns = accepts[r->conn_id];
+                }
+                break;
+            case TRACE_LOCK_ACQUIRE: t->lock_ns = r->timestamp_ns; break;
+            case TRACE_FIRST_BYTE: t->first_byte_ns = r->timestamp_ns; break;
+            case TRACE_COMPLETE:
+                t->complete_ns = r->timestamp_ns;
+                t->bytes = r->value;
+                t->status = r->status;
+                break;
+        }
+    }
+
+    // One line per request, in start order
+    char start_time[32];
+    time_t start = header.realtime_base_ns / 1000000000;
+    strftime(start_time, sizeof(start_time), "%Y-%m-%d %H:%M:%S", localtime(&start));
+    if (csv) {
+        printf("trace_id,conn_id,op,start_us,accept_us,lock_us,first_byte_us,total_us,bytes,status\n");
+    } else {
+        printf("Trace started %s, %zu records\n\n", start_time, record_count);
+        printf("%10s %8s %6s %6s %10s %10s %10s %10s %12s %6s\n",
+               "start_ms", "request", "conn", "op", "accept", "lock", "1st_byte", "total", "bytes", "status");
+    }
+
+    // Durations for the summary, per operation
+    size_t op_counts[3] = { 0 };
+    uint64_t *totals[3], *waits[3];
+    for (int op = 0; op < 3; op++) {
+        totals[op] = malloc((timeline_cap + 1) * sizeof(uint64_t));
+        waits[op] = malloc((timeline_cap + 1) * sizeof(uint64_t));
+        if (!totals[op] || !waits[op]) goto out_of_memory;
+    }
+    size_t wait_counts[3] = { 0 };
+
+    for (size_t i = 0; i < record_count; i++) {
+        // Walk requests in the order they started
+        if (records[i].event != TRACE_REQUEST) continue;
+        Timeline *t = &timelines[records[i].trace_id];
+        char a[32], l[32], f[32], c[32];
+
+        if (csv) {
+            #define US(from, to) ((from) == NO_TIME || (to) == NO_TIME ? -1.0 : ((to) - (from)) / 1e3)
+            printf("%llu,%u,%s,%.1f,%.1f,%.1f,%.1f,%.1f,%llu,%d\n",
+                   (unsigned long long)t->trace_id, t->conn_id, op_name(t->op),
+                   (t->request_ns - header.monotonic_base_ns) / 1e3,
+                   US(t->accept_ns, t->request_ns), US(t->request_ns, t->lock_ns),
+                   US(t->request_ns, t->first_byte_ns), US(t->request_ns, t->complete_ns),
+                   (unsigned long long)t->bytes, t->status);
+            #undef US
+        } else {
+            printf("%10.3f %8llu %6u %6s %10s %10s %10s %10s %12llu %6d\n",
+                   (t->request_ns - header.monotonic_base_ns) / 1e6,
+                   (unsigned long long)t->trace_id, t->conn_id, op_name(t->op),
+                   span_ms(a, sizeof(a), t->accept_ns, t->request_ns),
+                   span_ms(l, sizeof(l), t->request_ns, t->lock_ns),
+                   span_ms(f, sizeof(f), t->request_ns, t->first_byte_ns),
+                   span_ms(c, sizeof(c), t->request_ns, t->complete_ns),
+                   (unsigned long long)t->bytes, t->status);
+        }
+
+        if (t->op >= 0 && t->op < 3 && t->complete_ns != NO_TIME) {
+            totals[t->op][op_counts[t->op]++] = t->complete_ns - t->request_ns;
+            if (t->lock_ns != NO_TIME) {
+                waits[t->op][wait_counts[t->op]++] = t->lock_ns - t->request_ns;
+            }
+        }
+    }
+
+    // Latency summary per operation
+    if (!csv) {
+        printf("\n");
+        for (int op = 0; op < 3; op++) {
+            if (op_counts[op] == 0) continue;
+            printf("%s: %zu requests\n", op_name(op), op_counts[op]);
+            print_percentiles("total", totals[op], op_counts[op]);
+            print_percentiles("lock wait", waits[op], wait_counts[op]);
+        }
+    }
+
+    for (int op = 0; op < 3; op++) {
+        free(totals[op]);
+        free(waits[op]);
+    }
+    free(records);
+    free(timelines);
+    free(accepts);
+    free(conn_requests);
+    return 0;
+
+out_of_memory:
+    perror("Error building timelines");
+    return -1;
+}